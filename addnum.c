@@ -2,38 +2,467 @@
 //
 // At each step, either do: a += b, or b += a.
 // Can you make either a or b equal to c?
+//
+// Usage: addnum [-m METHOD] [-s STEPS] [-w] a b c
+//        addnum [-m METHOD] [-s STEPS] [-j THREADS] -f FILE
+//
+// The default solver (euclid) decides the answer with a few Euclid style
+// steps.  The original depth first search (dfs) is kept as a cross-check.
+// Its sums overflow when c is close to 2^64, so dfs128 is the same search
+// done with 128-bit sums, which is right over the whole 64-bit range.
+// "check" runs euclid and dfs128 and complains if they disagree.
+//
+// -w also prints the moves that reach c, as runs like "a3 b1 a2" meaning
+// do a += b three times, then b += a once, then a += b twice.
+//
+// -s gives up on a query after STEPS solver steps (0, the default, means
+// never give up).
+//
+// With -f, white space separated triples are read from FILE ("-" for
+// stdin), answered by a pool of THREADS worker threads, and printed in
+// input order as "yes", "no" or "unknown" (the step budget ran out).  Any
+// other character, a number past 2^64 - 1 or an incomplete last triple is
+// an error.  The number of queries per second
+// is reported on stderr.  Build with -pthread.
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MAX_THREADS	256
+#define BATCH_SIZE	(1 << 20)	// Queries read in at a time
+#define JOB_SIZE	1024		// Queries a worker takes at a time
+#define READ_SIZE	(1 << 20)
+
+enum {
+    METHOD_EUCLID,
+    METHOD_DFS,
+    METHOD_DFS128,
+    METHOD_CHECK
+};
+
+// The largest number of runs a witness can have.  Each run is one step of
+// the Euclid algorithm on (x, y) <= 2^64, and Fibonacci numbers are the
+// worst case for that, at 93 steps.
+#define MAX_RUNS	128
+
+// A run of count identical moves: 'a' is a += b, 'b' is b += a.
+typedef struct Run {
+    char     move;
+    uint64_t count;
+} Run;
+
+typedef struct Query {
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+} Query;
+
+// A batch of queries shared by the worker threads.  Each worker grabs the
+// next JOB_SIZE queries from next until they run out.
+typedef struct Batch {
+    const Query *queries;
+    signed char *results;
+    size_t       count;
+    atomic_size_t next;
+    int          method;
+    uint64_t     maxSteps;
+} Batch;
 
-static int solve(uint64_t a, uint64_t b, uint64_t c);
+// The worker threads, which are started once and then run every batch
+// together with the main thread.  generation counts the batches handed out,
+// and busy the workers that haven't finished the current one.
+typedef struct Pool {
+    pthread_mutex_t  lock;
+    pthread_cond_t   start;	// A new batch is ready, or quit is set
+    pthread_cond_t   done;	// busy dropped to 0
+    pthread_t        threads[MAX_THREADS];
+    int              numWorkers;
+    Batch           *batch;
+    unsigned         generation;
+    int              busy;
+    int              quit;
+} Pool;
+
+typedef struct Reader {
+    FILE   *fp;
+    char   *buf;
+    size_t  pos;
+    size_t  len;
+} Reader;
+
+static int      solve(uint64_t a, uint64_t b, uint64_t c, uint64_t maxSteps);
+static int      solve128(uint64_t a, uint64_t b, uint64_t c,
+			    uint64_t maxSteps);
+static int      solveEuclid(uint64_t a, uint64_t b, uint64_t c,
+			    uint64_t maxSteps);
+static int      findCoeffs(uint64_t a, uint64_t b, uint64_t c,
+			    uint64_t maxSteps, uint64_t *px, uint64_t *py);
+static int      witness(uint64_t a, uint64_t b, uint64_t c, Run *runs,
+			    int *numRuns);
+static int      replay(uint64_t a, uint64_t b, uint64_t c, char target,
+			    const Run *runs, int numRuns);
+static uint64_t gcd(uint64_t a, uint64_t b);
+static uint64_t modInverse(uint64_t a, uint64_t m);
+
+// addnumcheck.c includes this file to get at the solvers, and defines
+// ADDNUM_NO_MAIN to leave out the command line program.
+#ifndef ADDNUM_NO_MAIN
+static int      solveMethod(int method, uint64_t a, uint64_t b, uint64_t c,
+			    uint64_t maxSteps);
+static void     solveFile(const char *path, int method, uint64_t maxSteps,
+			    int numThreads);
+static void     poolStart(Pool *pool, int numWorkers);
+static void     poolRun(Pool *pool, Batch *batch);
+static void     poolStop(Pool *pool);
+static void    *poolThread(void *arg);
+static void    *solveThread(void *arg);
+static int      readNumber(Reader *r, uint64_t *val);
 
 int main(int argc, char *argv[])
 {
-    uint64_t a = 0, b = 0, c = 0;
+    uint64_t    a          = 0, b = 0, c = 0;
+    uint64_t    maxSteps   = 0;
+    const char *file       = NULL;
+    int         method     = METHOD_EUCLID;
+    int         numThreads = 1;
+    int         showMoves  = 0;
+    int         opt        = 0;
+    int         ret        = 0;
+
+    while ((opt = getopt(argc, argv, "m:s:f:j:w")) != -1) {
+	switch (opt) {
+	    case 'm':
+		if (strcmp(optarg, "euclid") == 0)
+		    method = METHOD_EUCLID;
+		else if (strcmp(optarg, "dfs") == 0)
+		    method = METHOD_DFS;
+		else if (strcmp(optarg, "dfs128") == 0)
+		    method = METHOD_DFS128;
+		else if (strcmp(optarg, "check") == 0)
+		    method = METHOD_CHECK;
+		else
+		    goto usage;
+		break;
+	    case 's': maxSteps   = strtoull(optarg, NULL, 0); break;
+	    case 'f': file       = optarg;                    break;
+	    case 'j': numThreads = atoi(optarg);              break;
+	    case 'w': showMoves  = 1;                         break;
+	    default:  goto usage;
+	}
+    }
+    if (numThreads < 1 || numThreads > MAX_THREADS)
+	goto usage;
 
-    if (argc < 4) {
-        printf("Usage: %s a b c\n", argv[0]);
-        exit(0);
+    if (file != NULL) {
+	solveFile(file, method, maxSteps, numThreads);
+	return 0;
     }
-    a = strtoull(argv[1], NULL, 0);
-    b = strtoull(argv[2], NULL, 0);
-    c = strtoull(argv[3], NULL, 0);
 
-    if (solve(a, b, c))
-        printf("There is a solution\n");
+    if (argc - optind < 3)
+	goto usage;
+    a = strtoull(argv[optind], NULL, 0);
+    b = strtoull(argv[optind+1], NULL, 0);
+    c = strtoull(argv[optind+2], NULL, 0);
+
+    ret = solveMethod(method, a, b, c, maxSteps);
+    if (ret > 0)
+	printf("There is a solution\n");
+    else if (ret == 0)
+	printf("There is NO solution\n");
     else
-        printf("There is NO solution\n");
+	printf("Gave up after %llu steps\n", (unsigned long long) maxSteps);
+
+    if (showMoves && ret > 0) {
+	Run  runs[MAX_RUNS];
+	int  numRuns = 0;
+	int  i       = 0;
+	char target  = witness(a, b, c, runs, &numRuns);
+
+	printf("Moves:");
+	for (i=0;i<numRuns;i++)
+	    printf(" %c%llu", runs[i].move, (unsigned long long) runs[i].count);
+	printf("%s (then %c == c)\n", numRuns == 0 ? " none" : "", target);
+    }
     return 0;
+
+usage:
+    printf("Usage: %s [-m euclid|dfs|dfs128|check] [-s STEPS] [-w] a b c\n",
+	    argv[0]);
+    printf("       %s [-m euclid|dfs|dfs128|check] [-s STEPS] [-j THREADS] "
+	    "-f FILE\n", argv[0]);
+    exit(0);
+}
+
+// Returns 1 if there is a solution, 0 if not, or -1 if the solver gave up
+// after maxSteps steps.
+static int solveMethod(int method, uint64_t a, uint64_t b, uint64_t c,
+			uint64_t maxSteps)
+{
+    Run  runs[MAX_RUNS];
+    int  numRuns = 0;
+    int  ret     = 0;
+    char target  = 0;
+
+    switch (method) {
+	case METHOD_DFS:
+	    return solve(a, b, c, maxSteps);
+	case METHOD_DFS128:
+	    return solve128(a, b, c, maxSteps);
+	case METHOD_CHECK:
+	    ret = solveEuclid(a, b, c, maxSteps);
+	    if (ret >= 0 && solve128(a, b, c, maxSteps) == !ret) {
+		fprintf(stderr, "Solvers disagree on %llu %llu %llu: "
+			"euclid says %d\n", (unsigned long long) a,
+			(unsigned long long) b, (unsigned long long) c, ret);
+		exit(1);
+	    }
+	    // A solution must also come with moves that really reach c.
+	    if (ret > 0) {
+		target = witness(a, b, c, runs, &numRuns);
+		if (!replay(a, b, c, target, runs, numRuns)) {
+		    fprintf(stderr, "Bad moves for %llu %llu %llu\n",
+			    (unsigned long long) a, (unsigned long long) b,
+			    (unsigned long long) c);
+		    exit(1);
+		}
+	    }
+	    return ret;
+	default:
+	    return solveEuclid(a, b, c, maxSteps);
+    }
+}
+
+// Answers every triple in path.  The input is read BATCH_SIZE queries at
+// a time.  Each batch is split among the main thread and the pool in
+// JOB_SIZE pieces, and the answers are printed in order once the whole
+// batch is done.
+static void solveFile(const char *path, int method, uint64_t maxSteps,
+			int numThreads)
+{
+    static const char *answers[] = { "unknown\n", "no\n", "yes\n" };
+    Query           *queries = malloc(BATCH_SIZE * sizeof(Query));
+    signed char     *results = malloc(BATCH_SIZE);
+    Pool             pool;
+    Reader           reader  = {0};
+    Batch            batch;
+    uint64_t         total   = 0;
+    struct timespec  start, end;
+    double           seconds = 0;
+
+    reader.fp  = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    reader.buf = malloc(READ_SIZE);
+    if (reader.fp == NULL || queries == NULL || results == NULL ||
+	    reader.buf == NULL) {
+	perror(path);
+	exit(1);
+    }
+
+    poolStart(&pool, numThreads - 1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+	size_t n = 0;
+	size_t i = 0;
+
+	while (n < BATCH_SIZE && readNumber(&reader, &queries[n].a)) {
+	    if (!readNumber(&reader, &queries[n].b) ||
+		    !readNumber(&reader, &queries[n].c)) {
+		fprintf(stderr, "%s: incomplete query at the end\n", path);
+		exit(1);
+	    }
+	    n++;
+	}
+	if (n == 0)
+	    break;
+
+	batch.queries  = queries;
+	batch.results  = results;
+	batch.count    = n;
+	batch.method   = method;
+	batch.maxSteps = maxSteps;
+	atomic_init(&batch.next, 0);
+
+	poolRun(&pool, &batch);
+
+	for (i=0;i<n;i++)
+	    fputs(answers[results[i] + 1], stdout);
+	total += n;
+    } while (!feof(reader.fp) || reader.pos < reader.len);
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    poolStop(&pool);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%llu queries in %.3f s (%.0f queries/s)\n",
+	    (unsigned long long) total, seconds,
+	    seconds > 0 ? total / seconds : 0.0);
+
+    if (reader.fp != stdin)
+	fclose(reader.fp);
+    free(reader.buf);
+    free(results);
+    free(queries);
 }
 
+// Starts numWorkers worker threads.  If a thread can't be created, the
+// pool makes do with the ones it has; the main thread works on every batch
+// too, so even an empty pool gets the work done.
+static void poolStart(Pool *pool, int numWorkers)
+{
+    int t;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->batch      = NULL;
+    pool->generation = 0;
+    pool->busy       = 0;
+    pool->quit       = 0;
+    for (t=0;t<numWorkers;t++) {
+	if (pthread_create(&pool->threads[t], NULL, poolThread, pool) != 0) {
+	    fprintf(stderr, "Could only start %d of %d threads\n", t + 1,
+		    numWorkers + 1);
+	    break;
+	}
+    }
+    pool->numWorkers = t;
+}
+
+// Solves batch on the main thread and every worker, and returns once all
+// of them are done with it.
+static void poolRun(Pool *pool, Batch *batch)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    pool->busy  = pool->numWorkers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    solveThread(batch);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0)
+	pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void poolStop(Pool *pool)
+{
+    int t;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (t=0;t<pool->numWorkers;t++)
+	pthread_join(pool->threads[t], NULL);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+static void *poolThread(void *arg)
+{
+    Pool     *pool = arg;
+    unsigned  seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+	while (pool->generation == seen && !pool->quit)
+	    pthread_cond_wait(&pool->start, &pool->lock);
+	if (pool->quit)
+	    break;
+	seen = pool->generation;
+	pthread_mutex_unlock(&pool->lock);
+
+	solveThread(pool->batch);
+
+	pthread_mutex_lock(&pool->lock);
+	if (--pool->busy == 0)
+	    pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void *solveThread(void *arg)
+{
+    Batch *batch = arg;
+
+    for (;;) {
+	size_t first = atomic_fetch_add(&batch->next, JOB_SIZE);
+	size_t last  = first + JOB_SIZE;
+	size_t i;
+
+	if (first >= batch->count)
+	    break;
+	if (last > batch->count)
+	    last = batch->count;
+	for (i=first;i<last;i++) {
+	    const Query *q = &batch->queries[i];
+	    batch->results[i] = solveMethod(batch->method, q->a, q->b, q->c,
+					    batch->maxSteps);
+	}
+    }
+    return NULL;
+}
+
+// Reads the next unsigned decimal number, skipping the white space before
+// it.  Returns 0 at end of file.  Anything else, or a number that doesn't
+// fit in 64 bits, is reported and ends the program.
+static int readNumber(Reader *r, uint64_t *val)
+{
+    uint64_t v     = 0;
+    int      found = 0;
+
+    for (;;) {
+	if (r->pos == r->len) {
+	    r->len = fread(r->buf, 1, READ_SIZE, r->fp);
+	    r->pos = 0;
+	    if (r->len == 0)
+		break;
+	}
+	while (r->pos < r->len) {
+	    unsigned char ch = r->buf[r->pos];
+	    unsigned      d  = ch - '0';
+
+	    if (d <= 9) {
+		if (v > (UINT64_MAX - d) / 10) {
+		    fprintf(stderr, "Number too large for 64 bits\n");
+		    exit(1);
+		}
+		v = v * 10 + d;
+		found = 1;
+	    } else if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+		if (found)
+		    goto done;
+	    } else {
+		fprintf(stderr, "Bad character '%c' in input\n", ch);
+		exit(1);
+	    }
+	    r->pos++;
+	}
+    }
+done:
+    *val = v;
+    return found;
+}
+#endif
+
 // The stack here only needs to be 128 deep because we only recurse through
 // the "faster" path, where we add to the smaller number.  This sequence
 // follows a fibonacci sequence pattern, so we will reach 2^64 in the number
 // of steps it takes for a fibonacci sequence to reach 2^64.  Given an initial
 // input of 0 1, this will take 96 steps.  Our actual c is supposed to be
 // less than 10^18 which is even less than 2^64.
-static int solve(uint64_t a, uint64_t b, uint64_t c)
+//
+// If maxSteps is not 0, give up and return -1 after that many iterations.
+static int solve(uint64_t a, uint64_t b, uint64_t c, uint64_t maxSteps)
 {
     // Make the first two stack elements be a fake solution.  That way, we
     // can simplify the termination logic because we will be sure to find
@@ -41,6 +470,7 @@ static int solve(uint64_t a, uint64_t b, uint64_t c)
     // that we actually failed to find a solution.
     uint64_t stack[256] = {0, c};
     int      i          = 2;
+    uint64_t steps      = 0;
 
     // Check the initial parameters for a solution.
     if (a == c || b == c)
@@ -51,25 +481,33 @@ static int solve(uint64_t a, uint64_t b, uint64_t c)
 	a = b;
 	b = tmp;
     }
+    // With a == 0 the search below never gets past the first step: it
+    // keeps popping (0, b) and pushing it again.  From (0, b) the reachable
+    // numbers are just the multiples of b.
+    if (a == 0)
+	return b != 0 && c % b == 0;
 
     // In this loop, a will always be less than b.
     do {
-        uint64_t sum = a + b;
+	uint64_t sum = a + b;
 
-        // If we went past the goal, backtrack by popping off the stack.
-        if (sum > c) {
+	if (maxSteps != 0 && ++steps > maxSteps)
+	    return -1;
+
+	// If we went past the goal, backtrack by popping off the stack.
+	if (sum > c) {
 	    b = stack[--i];
 	    a = stack[--i];
 	    sum = a + b;
 	}
 
-        // If we reached the goal exactly, we can stop.
-        if (sum == c) {
+	// If we reached the goal exactly, we can stop.
+	if (sum == c) {
 	    // If it was the fake solution, then there was none.
 	    if (i == 0)
 		return 0;
 	    // Otherwise it was a real solution.
-            return 1;
+	    return 1;
 	}
 
 	// Push the slower solution on the stack, where the lower value
@@ -85,3 +523,275 @@ static int solve(uint64_t a, uint64_t b, uint64_t c)
 	b = sum;
     } while(1);
 }
+
+// The same search as solve(), but with 128-bit values so that the sums
+// can't wrap around when c is close to 2^64.  With 64-bit sums, a + b and
+// a + sum can overflow to something small, which makes solve() follow (or
+// skip) the wrong branches.  Two 64-bit numbers add up to at most 2^65, so
+// 128 bits can never overflow here.
+static int solve128(uint64_t a64, uint64_t b64, uint64_t c64,
+			uint64_t maxSteps)
+{
+    typedef unsigned __int128 u128;
+
+    u128     a          = a64;
+    u128     b          = b64;
+    u128     c          = c64;
+    u128     stack[256] = {0, c};
+    int      i          = 2;
+    uint64_t steps      = 0;
+
+    if (a == c || b == c)
+	return 1;
+    if (a > b) {
+	u128 tmp = a;
+	a = b;
+	b = tmp;
+    }
+    if (a == 0)
+	return b != 0 && c % b == 0;
+
+    do {
+	u128 sum = a + b;
+
+	if (maxSteps != 0 && ++steps > maxSteps)
+	    return -1;
+
+	if (sum > c) {
+	    b = stack[--i];
+	    a = stack[--i];
+	    sum = a + b;
+	}
+
+	if (sum == c)
+	    return i != 0;
+
+	if (a + sum <= c) {
+	    stack[i++] = a;
+	    stack[i++] = sum;
+	}
+	a = b;
+	b = sum;
+    } while(1);
+}
+
+// Run backwards, each step is forced: the pair (x, y) can only have come
+// from (x - y, y) if x > y, or from (x, y - x) if y > x.  That is the
+// subtractive Euclid algorithm, so the pairs reachable from (a, b) are
+// exactly the pairs M * (a, b) where M is a 2x2 matrix of nonnegative
+// integers with determinant 1 (the Stern-Brocot/Calkin-Wilf matrices).
+// Every coprime pair (x, y) of nonnegative integers is a row of such a
+// matrix, so c is reachable if and only if
+//
+//   c = x*a + y*b   for some x, y >= 0 with gcd(x, y) == 1.
+//
+// With g = gcd(a, b), the solutions of x*a + y*b = c are the ones with
+// x == c/g * (a/g)^-1 (mod b/g), so we find the smallest x with a modular
+// inverse (the extended Euclid algorithm) and step through the others in
+// order, stopping at the first with gcd(x, y) == 1.  Any common factor of
+// x and y divides c/g, and for each prime factor of c/g only one residue
+// class of steps can be divisible by it, so only a handful of steps are
+// ever needed (c < 2^64 has at most 15 distinct prime factors).  Each step
+// is one O(log c) gcd, on top of one O(log c) modular inverse.
+//
+// If maxSteps is not 0, give up and return -1 after trying that many
+// solutions.
+//
+// Nothing here can overflow: x*a and y*b never exceed c.
+static int solveEuclid(uint64_t a, uint64_t b, uint64_t c, uint64_t maxSteps)
+{
+    uint64_t x = 0;
+    uint64_t y = 0;
+
+    return findCoeffs(a, b, c, maxSteps, &x, &y);
+}
+
+// Does the work for solveEuclid(), and on success also returns the x and y
+// with c = x*a + y*b and gcd(x, y) == 1.
+static int findCoeffs(uint64_t a, uint64_t b, uint64_t c, uint64_t maxSteps,
+			uint64_t *px, uint64_t *py)
+{
+    uint64_t g     = 0;
+    uint64_t x     = 0;
+    uint64_t y     = 0;
+    uint64_t steps = 0;
+
+    if (a == c) {
+	*px = 1;
+	*py = 0;
+	return 1;
+    }
+    if (b == c) {
+	*px = 0;
+	*py = 1;
+	return 1;
+    }
+
+    // If one of the numbers is 0, the other one just gets added to it
+    // any number of times.
+    if (a == 0 || b == 0) {
+	uint64_t step = a + b;
+	if (step == 0 || c % step != 0)
+	    return 0;
+	*px = (a == 0) ? 1 : c / a;
+	*py = (a == 0) ? c / b : 1;
+	return 1;
+    }
+
+    g = gcd(a, b);
+    if (c % g != 0)
+	return 0;
+    a /= g;
+    b /= g;
+    c /= g;
+
+    // Smallest x >= 0 with x*a == c (mod b).
+    x = (b == 1) ? 0 :
+	(uint64_t) ((unsigned __int128) (c % b) * modInverse(a % b, b) % b);
+    if (x > c / a)
+	return 0;
+    y = (c - x * a) / b;
+
+    // Try each solution (x + k*b, y - k*a) until y would go negative.
+    for (;;) {
+	if (maxSteps != 0 && ++steps > maxSteps)
+	    return -1;
+	if (gcd(x, y) == 1) {
+	    *px = x;
+	    *py = y;
+	    return 1;
+	}
+	if (y < a)
+	    return 0;
+	x += b;
+	y -= a;
+    }
+}
+
+// Finds the moves that make a or b equal to c, as runs of identical moves.
+// Returns 'a' or 'b' for the one that ends up equal to c, or 0 if there is
+// no solution.
+//
+// Think of the current pair as M * (a, b), starting with M = identity.
+// a += b adds the second row of M to the first, and b += a adds the first
+// row to the second.  With (x, y) from findCoeffs(), we want a final M
+// whose first row is (x, y).  Its second row (r, s) needs x*s - y*r == 1,
+// so s = x^-1 (mod y) taken in 1..y and r = (x*s - 1) / y, which also
+// makes r <= x and s <= y.  Every matrix of nonnegative integers with
+// determinant 1 is a product of those two row additions, in exactly one
+// way: the last move added the smaller row to the larger one.  So M is
+// taken apart by repeatedly subtracting the smaller row from the larger
+// as many times as it fits, which is the Euclid algorithm again, and gives
+// the runs last to first.
+static int witness(uint64_t a, uint64_t b, uint64_t c, Run *runs,
+		    int *numRuns)
+{
+    uint64_t p = 0, q = 0, r = 0, s = 0;
+    int      n = 0;
+    int      i = 0;
+
+    *numRuns = 0;
+    if (b == c && a != c)
+	return 'b';
+    if (findCoeffs(a, b, c, 0, &p, &q) != 1)
+	return 0;
+
+    if (q == 0) {
+	s = 1;
+    } else {
+	s = (q == 1) ? 1 : modInverse(p % q, q);
+	if (s == 0)
+	    s = q;
+	r = (uint64_t) (((unsigned __int128) p * s - 1) / q);
+    }
+
+    while (p != 1 || q != 0 || r != 0 || s != 1) {
+	uint64_t k = UINT64_MAX;
+
+	if (p >= r && q >= s) {
+	    if (r != 0)
+		k = p / r;
+	    if (s != 0 && q / s < k)
+		k = q / s;
+	    p -= k * r;
+	    q -= k * s;
+	    runs[n].move = 'a';
+	} else {
+	    if (p != 0)
+		k = r / p;
+	    if (q != 0 && s / q < k)
+		k = s / q;
+	    r -= k * p;
+	    s -= k * q;
+	    runs[n].move = 'b';
+	}
+	runs[n++].count = k;
+    }
+
+    // The runs came out last to first.
+    for (i=0;i<n/2;i++) {
+	Run tmp = runs[i];
+	runs[i] = runs[n-1-i];
+	runs[n-1-i] = tmp;
+    }
+    *numRuns = n;
+    return 'a';
+}
+
+// Plays the runs forward from (a, b) and checks that target ends up as c.
+// Values only grow, so once one passes c its exact value no longer matters
+// and it is clamped to c + 1 to keep the products from overflowing.
+static int replay(uint64_t a, uint64_t b, uint64_t c, char target,
+		    const Run *runs, int numRuns)
+{
+    unsigned __int128 x     = a;
+    unsigned __int128 y     = b;
+    unsigned __int128 limit = (unsigned __int128) c + 1;
+    int               i     = 0;
+
+    for (i=0;i<numRuns;i++) {
+	if (runs[i].move == 'a')
+	    x += (unsigned __int128) runs[i].count * y;
+	else
+	    y += (unsigned __int128) runs[i].count * x;
+	if (x > limit)
+	    x = limit;
+	if (y > limit)
+	    y = limit;
+    }
+    return (target == 'a' ? x : y) == c;
+}
+
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+    while (b != 0) {
+	uint64_t t = a % b;
+	a = b;
+	b = t;
+    }
+    return a;
+}
+
+// Returns the inverse of a modulo m, using the extended Euclid algorithm.
+// a and m must be coprime and m > 1.
+static uint64_t modInverse(uint64_t a, uint64_t m)
+{
+    __int128 t    = 0;
+    __int128 newT = 1;
+    uint64_t r    = m;
+    uint64_t newR = a;
+
+    while (newR != 0) {
+	uint64_t q   = r / newR;
+	__int128 tmp = t - (__int128) q * newT;
+	uint64_t rem = r - q * newR;
+
+	t    = newT;
+	newT = tmp;
+	r    = newR;
+	newR = rem;
+    }
+    if (t < 0)
+	t += m;
+    return (uint64_t) t;
+}
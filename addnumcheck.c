@@ -0,0 +1,354 @@
+// Differential tests and timings for the addnum.c solvers.
+//
+// Usage: addnumcheck [-n MAXC] [-s STEPS] [-b SECONDS]
+//
+// First, for every a, b <= SMALL_AB and c <= MAXC (default 200), the
+// numbers reachable from (a, b) are found by a breadth first search over
+// all pairs, and every solver has to agree with it exactly, within STEPS
+// steps (default 10^5).  This includes a == 0 and b == 0, which the depth
+// first search used to get stuck on.
+//
+// Then come adversarial inputs: neighbouring Fibonacci numbers (the worst
+// case for anything Euclid based), coprime and non-coprime pairs with c on
+// and off the lattice of their gcd, a or b equal to 0, and c with many
+// prime factors or close to 2^64.  The euclid solver is the reference
+// there, and every other solver that finishes within STEPS steps has to
+// give the same answer.
+//
+// Every "yes" from euclid, in both parts, also has to come with moves
+// (from witness()) that really reach c.
+//
+// Finally each solver is timed on worst case shaped inputs with c around
+// 10^3 .. 10^18, for at most SECONDS (default 1) per size.  The searches
+// get STEPS steps per query, and the number of queries they gave up on is
+// reported.
+//
+// To check a new solver, add it to the solvers table.  Build with:
+//
+// cc -O2 -pthread addnumcheck.c -o addnumcheck
+//
+// The exit status is nonzero if any check failed.
+#define ADDNUM_NO_MAIN
+#include "addnum.c"
+#include "ctrrng.h"
+
+#define SMALL_AB	30
+#define TIME_QUERIES	4096	// Queries per timing size
+
+typedef int (*SolveFn)(uint64_t a, uint64_t b, uint64_t c, uint64_t maxSteps);
+
+typedef struct Solver {
+    const char *name;
+    SolveFn     solve;
+    uint64_t    maxValue;	// Largest a, b or c it can take
+} Solver;
+
+// The 64-bit search adds up to three of the inputs, so it can only be
+// trusted below 2^64 / 3.
+static const Solver solvers[] = {
+    { "euclid", solveEuclid, UINT64_MAX     },
+    { "dfs",    solve,       UINT64_MAX / 3 },
+    { "dfs128", solve128,    UINT64_MAX     },
+};
+
+#define NUM_SOLVERS	((int) (sizeof(solvers) / sizeof(solvers[0])))
+
+// Results are added up here so the compiler can't skip computing them.
+static volatile uint64_t sink;
+
+static int      checkSmall(uint64_t maxC, uint64_t maxSteps);
+static int      checkOne(uint64_t a, uint64_t b, uint64_t c,
+			    uint64_t maxSteps);
+static int      checkMoves(uint64_t a, uint64_t b, uint64_t c);
+static int      checkAdversarial(uint64_t maxSteps);
+static void     timeSolvers(int e, uint64_t maxSteps, double budget);
+static uint64_t randomBelow(uint64_t *state, uint64_t n);
+static double   now(void);
+
+int main(int argc, char *argv[])
+{
+    uint64_t maxC     = 200;
+    uint64_t maxSteps = 100000;
+    double   budget   = 1.0;
+    int      failed   = 0;
+    int      opt      = 0;
+    int      e        = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:b:")) != -1) {
+	switch (opt) {
+	    case 'n': maxC     = strtoull(optarg, NULL, 0); break;
+	    case 's': maxSteps = strtoull(optarg, NULL, 0); break;
+	    case 'b': budget   = atof(optarg);              break;
+	    default:
+		printf("Usage: addnumcheck [-n MAXC] [-s STEPS] "
+			"[-b SECONDS]\n");
+		exit(1);
+	}
+    }
+
+    printf("Checking a, b <= %d, c <= %llu against breadth first search...\n",
+	    SMALL_AB, (unsigned long long) maxC);
+    failed |= checkSmall(maxC, maxSteps);
+
+    printf("Checking adversarial inputs...\n");
+    failed |= checkAdversarial(maxSteps);
+
+    printf("\n%-8s %8s %12s %12s\n", "solver", "c <", "ns/query", "gave up");
+    for (e=3;e<=18;e+=3)
+	timeSolvers(e, maxSteps, budget);
+
+    printf("\n%s\n", failed ? "FAILED" : "All checks passed");
+    return failed;
+}
+
+// Compares every solver with an exhaustive search for all small inputs.
+// Since the numbers only grow, a pair with either number above maxC can
+// never lead to a c <= maxC, so the search only has to visit pairs inside
+// the (maxC + 1)^2 square.  Returns nonzero on failure.
+static int checkSmall(uint64_t maxC, uint64_t maxSteps)
+{
+    size_t    side    = maxC + 1;
+    char     *visited = malloc(side * side);
+    char     *reach   = malloc(side);
+    uint64_t *queue   = malloc(side * side * sizeof(uint64_t));
+    uint64_t  a, b, c;
+    int       bad     = 0;
+    int       i;
+
+    if (visited == NULL || reach == NULL || queue == NULL) {
+	printf("  Not enough memory for MAXC %llu\n", (unsigned long long) maxC);
+	exit(1);
+    }
+
+    for (a=0;a<=SMALL_AB;a++) {
+	for (b=0;b<=SMALL_AB;b++) {
+	    size_t head = 0, tail = 0;
+
+	    memset(visited, 0, side * side);
+	    memset(reach, 0, side);
+	    if (a <= maxC)
+		reach[a] = 1;
+	    if (b <= maxC)
+		reach[b] = 1;
+	    if (a <= maxC && b <= maxC) {
+		visited[a * side + b] = 1;
+		queue[tail++] = a * side + b;
+	    }
+	    while (head < tail) {
+		uint64_t u = queue[head] / side;
+		uint64_t v = queue[head++] % side;
+
+		reach[u] = reach[v] = 1;
+		if (u + v <= maxC && !visited[(u + v) * side + v]) {
+		    visited[(u + v) * side + v] = 1;
+		    queue[tail++] = (u + v) * side + v;
+		}
+		if (u + v <= maxC && !visited[u * side + u + v]) {
+		    visited[u * side + u + v] = 1;
+		    queue[tail++] = u * side + u + v;
+		}
+	    }
+
+	    for (c=0;c<=maxC;c++) {
+		for (i=0;i<NUM_SOLVERS;i++) {
+		    int ret = solvers[i].solve(a, b, c, maxSteps);
+		    if (ret != reach[c] && bad++ < 10)
+			printf("  %s %llu %llu %llu: got %d, expected %d\n",
+				solvers[i].name, (unsigned long long) a,
+				(unsigned long long) b, (unsigned long long) c,
+				ret, reach[c]);
+		}
+		if (reach[c])
+		    bad += checkMoves(a, b, c);
+	    }
+	}
+    }
+
+    free(queue);
+    free(reach);
+    free(visited);
+    return bad != 0;
+}
+
+// Checks that every solver that can take (a, b, c) and finishes within
+// maxSteps agrees with euclid.  Returns nonzero on failure.
+static int checkOne(uint64_t a, uint64_t b, uint64_t c, uint64_t maxSteps)
+{
+    int expected = solveEuclid(a, b, c, 0);
+    int bad      = 0;
+    int i;
+
+    for (i=1;i<NUM_SOLVERS;i++) {
+	int ret;
+
+	if (a > solvers[i].maxValue || b > solvers[i].maxValue ||
+		c > solvers[i].maxValue)
+	    continue;
+	ret = solvers[i].solve(a, b, c, maxSteps);
+	if (ret >= 0 && ret != expected) {
+	    printf("  %s %llu %llu %llu: got %d, euclid says %d\n",
+		    solvers[i].name, (unsigned long long) a,
+		    (unsigned long long) b, (unsigned long long) c, ret,
+		    expected);
+	    bad = 1;
+	}
+    }
+    if (expected)
+	bad |= checkMoves(a, b, c);
+    return bad;
+}
+
+// Checks that the witness for a reachable c really reaches it.
+static int checkMoves(uint64_t a, uint64_t b, uint64_t c)
+{
+    Run  runs[MAX_RUNS];
+    int  numRuns = 0;
+    char target  = witness(a, b, c, runs, &numRuns);
+
+    if (target != 0 && replay(a, b, c, target, runs, numRuns))
+	return 0;
+    printf("  witness %llu %llu %llu: moves don't reach c\n",
+	    (unsigned long long) a, (unsigned long long) b,
+	    (unsigned long long) c);
+    return 1;
+}
+
+// Returns nonzero on failure.
+static int checkAdversarial(uint64_t maxSteps)
+{
+    // Product of the primes up to 47, the most distinct prime factors any
+    // c below 10^18 can have.
+    static const uint64_t primorial = UINT64_C(614889782588491410);
+    uint64_t fib[94];
+    uint64_t state = 1;
+    uint64_t d;
+    int      bad   = 0;
+    int      i, j;
+
+    fib[0] = 0;
+    fib[1] = 1;
+    for (i=2;i<94;i++)
+	fib[i] = fib[i-1] + fib[i-2];
+
+    // Neighbouring Fibonacci numbers, in both orders, with c on, next to,
+    // and in between later Fibonacci numbers.
+    for (i=0;i<92;i++) {
+	for (j=i+1;j<94;j++) {
+	    for (d=0;d<3;d++) {
+		uint64_t c = fib[j] + d - 1;
+		bad |= checkOne(fib[i], fib[i+1], c, maxSteps);
+		bad |= checkOne(fib[i+1], fib[i], c, maxSteps);
+	    }
+	    if (j > i + 1)
+		bad |= checkOne(fib[i], fib[i+1], fib[j] + fib[j-2],
+				maxSteps);
+	}
+	bad |= checkOne(fib[i], fib[i+1], primorial, maxSteps);
+	bad |= checkOne(fib[i], fib[i+1], UINT64_MAX, maxSteps);
+    }
+
+    // Pairs with a common factor g, where only multiples of g can be
+    // reached, against coprime pairs (g == 1).
+    for (i=0;i<20000;i++) {
+	static const uint64_t factors[] = { 1, 2, 6, 30, 210, 1000003 };
+	uint64_t g = factors[i % 6];
+	uint64_t p = 1 + randomBelow(&state, 1000);
+	uint64_t q = 1 + randomBelow(&state, 1000);
+	uint64_t k = randomBelow(&state, 200000);
+
+	while (gcd(p, q) != 1)
+	    q++;
+	bad |= checkOne(g * p, g * q, g * k, maxSteps);
+	bad |= checkOne(g * p, g * q, g * k + 1, maxSteps);
+	bad |= checkOne(g * p, g * q, g * k * 7 + g * p * q, maxSteps);
+    }
+
+    // One or both of the numbers 0.
+    for (d=0;d<50;d++) {
+	bad |= checkOne(0, d, d * 12345, maxSteps);
+	bad |= checkOne(0, d, d * 12345 + 1, maxSteps);
+	bad |= checkOne(d, 0, d * 999983, maxSteps);
+	bad |= checkOne(d, 0, d * 999983 + 7, maxSteps);
+	bad |= checkOne(0, 0, d, maxSteps);
+	bad |= checkOne(d, d + 1, 0, maxSteps);
+    }
+    bad |= checkOne(0, 3, UINT64_MAX, maxSteps);
+    bad |= checkOne(UINT64_MAX, 0, UINT64_MAX, maxSteps);
+
+    // Huge numbers, where the 64-bit search can overflow.
+    for (i=0;i<2000;i++) {
+	uint64_t a = ctrDraw(42, 3 * i) | (UINT64_C(1) << 61);
+	uint64_t b = ctrDraw(42, 3 * i + 1) | (UINT64_C(1) << 61);
+	uint64_t c = ctrDraw(42, 3 * i + 2) | (UINT64_C(1) << 63);
+
+	bad |= checkOne(a, b, c, maxSteps);
+	bad |= checkOne(a % 1000 + 1, b % 1000 + 1, c, maxSteps);
+	bad |= checkOne(a % 1000 + 1, b % 1000 + 1, primorial, maxSteps);
+    }
+    return bad;
+}
+
+// Times every solver on TIME_QUERIES queries with c just below 10^e: half
+// of them with a and b neighbouring Fibonacci numbers, half with random
+// small a and b, which gives the searches the most room to branch.
+static void timeSolvers(int e, uint64_t maxSteps, double budget)
+{
+    Query    queries[TIME_QUERIES];
+    uint64_t top   = 1;
+    uint64_t state = e;
+    uint64_t f0    = 1, f1 = 2;
+    char     size[8];
+    int      i, s;
+
+    for (i=0;i<e;i++)
+	top *= 10;
+    while (f1 < top / 1000) {
+	uint64_t t = f0 + f1;
+	f0 = f1;
+	f1 = t;
+    }
+
+    for (i=0;i<TIME_QUERIES;i++) {
+	queries[i].c = top - 1 - randomBelow(&state, top / 10);
+	if (i & 1) {
+	    queries[i].a = f0;
+	    queries[i].b = f1;
+	} else {
+	    queries[i].a = 1 + randomBelow(&state, 100);
+	    queries[i].b = 1 + randomBelow(&state, 100);
+	}
+    }
+
+    snprintf(size, sizeof(size), "1e%d", e);
+    for (s=0;s<NUM_SOLVERS;s++) {
+	uint64_t gaveUp = 0;
+	double   start  = now();
+	double   time   = 0;
+
+	for (i=0;i<TIME_QUERIES;i++) {
+	    int ret = solvers[s].solve(queries[i].a, queries[i].b,
+					queries[i].c, maxSteps);
+	    gaveUp += ret < 0;
+	    sink   += ret;
+	    if ((time = now() - start) > budget) {
+		i++;
+		break;
+	    }
+	}
+	printf("%-8s %8s %12.1f %7llu/%-4d\n", solvers[s].name, size,
+		time * 1e9 / i, (unsigned long long) gaveUp, i);
+    }
+}
+
+static uint64_t randomBelow(uint64_t *state, uint64_t n)
+{
+    return ctrBounded(1234, (*state)++, n);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
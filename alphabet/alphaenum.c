@@ -0,0 +1,158 @@
+// Library version of the enumerator in alphabet.c.  See alphaenum.h.
+#include <stdlib.h>
+#include <string.h>
+#include "alphaenum.h"
+
+static void buildTemplate(AlphaEnum *e);
+
+int alphaEnumInit(AlphaEnum *e, const char *alphabet, int minLen,
+			int maxLen, int separator)
+{
+    int    alphaLen = 0;
+    size_t maxStride = 0;
+
+    memset(e, 0, sizeof(*e));
+    if (alphabet == NULL || minLen < 1 || maxLen < minLen)
+	return -1;
+    alphaLen = strlen(alphabet);
+    if (alphaLen == 0)
+	return -1;
+
+    maxStride = maxLen + (separator >= 0);
+    e->alphabet  = alphabet;
+    e->alphaLen  = alphaLen;
+    e->maxLen    = maxLen;
+    e->separator = separator;
+    e->len       = minLen;
+    e->buffer    = malloc(maxStride * alphaLen * alphaLen);
+    e->letters   = malloc(maxLen * sizeof(int));
+    if (e->buffer == NULL || e->letters == NULL) {
+	alphaEnumFree(e);
+	return -1;
+    }
+    return 0;
+}
+
+void alphaEnumFree(AlphaEnum *e)
+{
+    free(e->letters);
+    free(e->buffer);
+    e->letters = NULL;
+    e->buffer  = NULL;
+}
+
+/**
+ * Builds the template block for the current length.  For lengths of 2 or
+ * more, this is alphaLen^2 words, all starting with the first letter and
+ * ending with every possible combination of the last 2 letters.  Length 1
+ * is a special case that just holds every letter once.
+ */
+static void buildTemplate(AlphaEnum *e)
+{
+    const char *alphabet = e->alphabet;
+    int         alphaLen = e->alphaLen;
+    int         len      = e->len;
+    int         i        = 0;
+
+    e->stride = len + (e->separator >= 0);
+
+    if (len == 1) {
+	for (i=0;i<alphaLen;i++) {
+	    e->buffer[i * e->stride] = alphabet[i];
+	    if (e->separator >= 0)
+		e->buffer[i * e->stride + 1] = e->separator;
+	}
+	e->bufLen = e->stride * alphaLen;
+	return;
+    }
+
+    e->bufLen = e->stride * alphaLen * alphaLen;
+
+    // Initialize buffer to contain all first letters.
+    memset(e->buffer, alphabet[0], e->bufLen);
+
+    // Now write all the last 2 letters and separators, which will after
+    // this not change while this length is being generated.
+    {
+	// Let0 is the 2nd to last letter.  Let1 is the last letter.
+	int let0 = 0;
+	int let1 = 0;
+	for (i=len-2;i<e->bufLen;i+=e->stride) {
+	    e->buffer[i]   = alphabet[let0];
+	    e->buffer[i+1] = alphabet[let1++];
+	    if (e->separator >= 0)
+		e->buffer[i+2] = e->separator;
+	    if (let1 == alphaLen) {
+		let1 = 0;
+		let0++;
+	    }
+	}
+    }
+
+    // Set all the letters to 0.
+    for (i=0;i<len;i++)
+	e->letters[i] = 0;
+}
+
+int alphaEnumNext(AlphaEnum *e, AlphaBatch *batch)
+{
+    while (e->len <= e->maxLen) {
+	int len = e->len;
+
+	if (!e->primed) {
+	    // First block of this length is the template itself.
+	    buildTemplate(e);
+	    e->primed = 1;
+	    goto emit;
+	}
+
+	// Increment the third to last letter, carrying to the left as
+	// needed, exactly like generate() in alphabet.c.
+	if (len > 2) {
+	    int i = len - 3;
+	    do {
+		char c;
+		int  j;
+
+		if (++e->letters[i] >= e->alphaLen)
+		    e->letters[i] = 0;
+
+		c = e->alphabet[e->letters[i]];
+		for (j=i;j<e->bufLen;j+=e->stride)
+		    e->buffer[j] = c;
+
+		if (e->letters[i] != 0)
+		    goto emit;
+	    } while (--i >= 0);
+	}
+
+	// Carried past the first letter, so this length is finished.
+	e->len++;
+	e->primed = 0;
+    }
+    return 0;
+
+emit:
+    batch->words  = e->buffer;
+    batch->len    = e->len;
+    batch->stride = e->stride;
+    batch->count  = e->bufLen / e->stride;
+    return 1;
+}
+
+int alphaEnumVisit(AlphaEnum *e, AlphaVisitor visit, void *ctx)
+{
+    AlphaBatch batch;
+
+    while (alphaEnumNext(e, &batch)) {
+	const char *word = batch.words;
+	int         i    = 0;
+	int         ret  = 0;
+
+	for (i=0;i<batch.count;i++,word+=batch.stride) {
+	    if ((ret = visit(word, batch.len, ctx)) != 0)
+		return ret;
+	}
+    }
+    return 0;
+}
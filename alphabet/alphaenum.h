@@ -0,0 +1,76 @@
+// In-process enumeration of all combinations of an alphabet.
+//
+// This is the engine from alphabet.c packaged as a library, so that a
+// consumer can look at the candidates directly instead of parsing them
+// back out of a pipe.  It uses the same trick: a template block holding
+// alphaLen^2 words with the last 2 letters prefilled, where each step only
+// rewrites the letters to the left of those 2.
+//
+// There are two ways to use it.  The batch iterator hands out one block at
+// a time:
+//
+//     AlphaEnum  e;
+//     AlphaBatch b;
+//
+//     alphaEnumInit(&e, "abc", 1, 6, -1);
+//     while (alphaEnumNext(&e, &b)) {
+//         for (i=0;i<b.count;i++)
+//             hash(b.words + i * b.stride, b.len);
+//     }
+//     alphaEnumFree(&e);
+//
+// The visitor variant calls a function once per word instead.
+//
+// Build by compiling alphaenum.c along with your program.
+#ifndef ALPHAENUM_H
+#define ALPHAENUM_H
+
+typedef struct AlphaBatch {
+    const char *words;      // First word of the block
+    int         len;        // Length of every word in the block
+    int         stride;     // Distance from one word to the next
+    int         count;      // Number of words in the block
+} AlphaBatch;
+
+typedef struct AlphaEnum {
+    const char *alphabet;
+    int         alphaLen;
+    int         maxLen;
+    int         separator;  // Character after each word, or -1 for none
+    int         len;        // Length currently being generated
+    int         primed;     // Nonzero once the template for len is built
+    int         stride;
+    int         bufLen;
+    int        *letters;
+    char       *buffer;
+} AlphaEnum;
+
+// Return nonzero to stop the enumeration early.
+typedef int (*AlphaVisitor)(const char *word, int len, void *ctx);
+
+/**
+ * Sets up an enumeration of all words of length minLen..maxLen.  If
+ * separator is not negative, it is stored after every word (use '\n' to
+ * get the same bytes that alphabet.c writes, or '\0' to get C strings).
+ * Otherwise words are packed back to back.  Returns 0 on success or -1 if
+ * the arguments are bad or memory could not be allocated.
+ */
+int  alphaEnumInit(AlphaEnum *e, const char *alphabet, int minLen,
+			int maxLen, int separator);
+
+/**
+ * Fills in the next block of words.  The block points into memory owned
+ * by the enumerator and is only valid until the next call.  Returns 0 when
+ * there are no more words.
+ */
+int  alphaEnumNext(AlphaEnum *e, AlphaBatch *batch);
+
+/**
+ * Calls visit() on every remaining word.  Returns the nonzero value that
+ * visit() returned if it stopped early, otherwise 0.
+ */
+int  alphaEnumVisit(AlphaEnum *e, AlphaVisitor visit, void *ctx);
+
+void alphaEnumFree(AlphaEnum *e);
+
+#endif
@@ -0,0 +1,372 @@
+// Throughput benchmark for the alphabet generators.
+//
+// Every variant is a program that takes the maximum length as its only
+// argument and writes all the combinations to stdout, like alphabet.c and
+// alphabet3.c do.  This harness runs each variant for a range of lengths
+// into each of these sinks:
+//
+//   null  - stdout is /dev/null
+//   pipe  - stdout is a pipe to a drain process that reads and discards
+//   tmpfs - stdout is a file in /dev/shm
+//
+// and reports lines/s, GB/s, syscalls per GB and cycles per line.
+//
+// Usage: bench [-a alphaLen] [-r repeats] minLen maxLen [name=path ...]
+//
+// With no name=path arguments, ./alphabet and ./alphabet3 are used.  To
+// compare a new variant (threaded, SIMD, splice, ...), build it as its own
+// program and add it on the command line, for example:
+//
+// ./bench 3 5 alphabet=./alphabet alphabet3=./alphabet3 splice=./splice
+//
+// Syscall counts come from /proc/<pid>/io and cycles from perf_event_open().
+// If either isn't available, that column is printed as "-".
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+
+#define MAX_VARIANTS	32
+#define DRAIN_SIZE	(1 << 20)
+
+typedef struct Variant {
+    const char *name;
+    const char *path;
+} Variant;
+
+typedef enum Sink {
+    SINK_NULL,
+    SINK_PIPE,
+    SINK_TMPFS,
+    NUM_SINKS
+} Sink;
+
+typedef struct Result {
+    double   seconds;
+    uint64_t bytes;       // Bytes seen by the sink, or 0 if unknown
+    int64_t  syscalls;    // -1 if unknown
+    int64_t  cycles;      // -1 if unknown
+} Result;
+
+static const char *sinkNames[NUM_SINKS] = { "null", "pipe", "tmpfs" };
+
+static int      runOnce(const Variant *v, int len, Sink sink, Result *res);
+static pid_t    startDrain(int readFd, int writeFd, int resultFd);
+static int      openCycleCounter(pid_t pid);
+static int64_t  readSyscalls(pid_t pid);
+static double   now(void);
+
+int main(int argc, char *argv[])
+{
+    Variant  variants[MAX_VARIANTS];
+    int      numVariants = 0;
+    int      alphaLen    = 62;
+    int      repeats     = 1;
+    int      minLen      = 0;
+    int      maxLen      = 0;
+    int      opt         = 0;
+    int      i           = 0;
+
+    while ((opt = getopt(argc, argv, "a:r:")) != -1) {
+	switch (opt) {
+	    case 'a': alphaLen = atoi(optarg); break;
+	    case 'r': repeats  = atoi(optarg); break;
+	    default:  goto usage;
+	}
+    }
+    if (argc - optind < 2)
+	goto usage;
+    minLen = atoi(argv[optind++]);
+    maxLen = atoi(argv[optind++]);
+    if (minLen < 1 || maxLen < minLen || repeats < 1)
+	goto usage;
+
+    for (i=optind;i<argc && numVariants<MAX_VARIANTS;i++) {
+	char *eq = strchr(argv[i], '=');
+	if (eq == NULL)
+	    goto usage;
+	*eq = '\0';
+	variants[numVariants].name = argv[i];
+	variants[numVariants].path = eq + 1;
+	numVariants++;
+    }
+    if (numVariants == 0) {
+	variants[0].name = "alphabet";
+	variants[0].path = "./alphabet";
+	variants[1].name = "alphabet3";
+	variants[1].path = "./alphabet3";
+	numVariants = 2;
+    }
+
+    printf("%-12s %-6s %4s %14s %14s %8s %14s %12s\n", "variant", "sink",
+	    "len", "lines", "lines/s", "GB/s", "syscalls/GB", "cycles/line");
+
+    for (i=0;i<numVariants;i++) {
+	int len;
+	for (len=minLen;len<=maxLen;len++) {
+	    // Every length from 1 up to len is printed, with a newline each.
+	    uint64_t lines = 0;
+	    uint64_t bytes = 0;
+	    uint64_t count = 1;
+	    int      l;
+	    Sink     sink;
+
+	    for (l=1;l<=len;l++) {
+		count *= alphaLen;
+		lines += count;
+		bytes += count * (l + 1);
+	    }
+
+	    for (sink=0;sink<NUM_SINKS;sink++) {
+		Result best = {0};
+		double gb   = bytes / 1e9;
+		int    r;
+
+		// Keep the fastest of the repeats.
+		for (r=0;r<repeats;r++) {
+		    Result res;
+		    if (runOnce(&variants[i], len, sink, &res) < 0)
+			exit(1);
+		    if (r == 0 || res.seconds < best.seconds)
+			best = res;
+		}
+		if (best.bytes != 0 && best.bytes != bytes) {
+		    fprintf(stderr, "%s: length %d wrote %llu bytes, "
+			    "expected %llu\n", variants[i].name, len,
+			    (unsigned long long) best.bytes,
+			    (unsigned long long) bytes);
+		}
+
+		printf("%-12s %-6s %4d %14llu %14.0f %8.3f ", variants[i].name,
+			sinkNames[sink], len, (unsigned long long) lines,
+			lines / best.seconds, gb / best.seconds);
+		if (best.syscalls >= 0)
+		    printf("%14.1f ", best.syscalls / gb);
+		else
+		    printf("%14s ", "-");
+		if (best.cycles >= 0)
+		    printf("%12.2f\n", (double) best.cycles / lines);
+		else
+		    printf("%12s\n", "-");
+		fflush(stdout);
+	    }
+	}
+    }
+    return 0;
+
+usage:
+    fprintf(stderr, "Usage: %s [-a alphaLen] [-r repeats] minLen maxLen "
+	    "[name=path ...]\n", argv[0]);
+    exit(1);
+}
+
+/**
+ * Runs one variant once with stdout connected to the given sink.  The
+ * child waits on a pipe before calling exec() so that the cycle counter
+ * can be attached to it first.  Only the variant itself is measured, not
+ * the drain process.
+ */
+static int runOnce(const Variant *v, int len, Sink sink, Result *res)
+{
+    char      lenArg[16];
+    char      tmpName[] = "/dev/shm/alphabench.XXXXXX";
+    int       outFd     = -1;
+    int       goPipe[2];
+    int       dataPipe[2];
+    int       countPipe[2];
+    pid_t     drain     = -1;
+    pid_t     child     = 0;
+    int       cycleFd   = -1;
+    int       statFd    = -1;
+    siginfo_t info;
+    double    start     = 0;
+
+    memset(res, 0, sizeof(*res));
+    snprintf(lenArg, sizeof(lenArg), "%d", len);
+
+    switch (sink) {
+	case SINK_NULL:
+	    outFd = open("/dev/null", O_WRONLY);
+	    break;
+	case SINK_PIPE:
+	    if (pipe(dataPipe) < 0)
+		break;
+	    if (pipe(countPipe) < 0) {
+		close(dataPipe[0]);
+		close(dataPipe[1]);
+		break;
+	    }
+	    drain = startDrain(dataPipe[0], dataPipe[1], countPipe[1]);
+	    close(dataPipe[0]);
+	    close(countPipe[1]);
+	    outFd = dataPipe[1];
+	    break;
+	case SINK_TMPFS:
+	    outFd = mkstemp(tmpName);
+	    if (outFd >= 0) {
+		unlink(tmpName);
+		statFd = dup(outFd);
+	    }
+	    break;
+	default:
+	    break;
+    }
+    if (outFd < 0 || pipe(goPipe) < 0) {
+	perror("bench: sink");
+	return -1;
+    }
+
+    child = fork();
+    if (child < 0) {
+	perror("bench: fork");
+	return -1;
+    }
+    if (child == 0) {
+	char go;
+	close(goPipe[1]);
+	if (read(goPipe[0], &go, 1) != 1)
+	    _exit(127);
+	dup2(outFd, STDOUT_FILENO);
+	execl(v->path, v->path, lenArg, (char *) NULL);
+	perror(v->path);
+	_exit(127);
+    }
+    close(goPipe[0]);
+    close(outFd);
+
+    cycleFd = openCycleCounter(child);
+
+    start = now();
+    if (write(goPipe[1], "g", 1) != 1)
+	return -1;
+    close(goPipe[1]);
+
+    // Wait for the child to exit but leave it as a zombie, so that its
+    // I/O accounting can still be read.
+    if (waitid(P_PID, child, &info, WEXITED | WNOWAIT) < 0) {
+	perror("bench: waitid");
+	return -1;
+    }
+    res->seconds  = now() - start;
+    res->syscalls = readSyscalls(child);
+    waitpid(child, NULL, 0);
+
+    if (info.si_code != CLD_EXITED || info.si_status != 0) {
+	fprintf(stderr, "bench: %s %d failed\n", v->path, len);
+	return -1;
+    }
+
+    res->cycles = -1;
+    if (cycleFd >= 0) {
+	uint64_t cycles = 0;
+	if (read(cycleFd, &cycles, sizeof(cycles)) == sizeof(cycles))
+	    res->cycles = cycles;
+	close(cycleFd);
+    }
+
+    if (sink == SINK_PIPE) {
+	if (read(countPipe[0], &res->bytes, sizeof(res->bytes)) !=
+		sizeof(res->bytes))
+	    res->bytes = 0;
+	close(countPipe[0]);
+	waitpid(drain, NULL, 0);
+    } else if (sink == SINK_TMPFS) {
+	struct stat st;
+	if (fstat(statFd, &st) == 0)
+	    res->bytes = st.st_size;
+	close(statFd);
+    }
+    return 0;
+}
+
+/**
+ * Forks a process that reads everything from readFd and then writes the
+ * number of bytes it read to resultFd.  writeFd is the other end of the
+ * pipe, which the drain must close or it would never see end of file.
+ */
+static pid_t startDrain(int readFd, int writeFd, int resultFd)
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+	char    *buf   = malloc(DRAIN_SIZE);
+	uint64_t total = 0;
+	ssize_t  n;
+
+	close(writeFd);
+
+	while ((n = read(readFd, buf, DRAIN_SIZE)) > 0)
+	    total += n;
+	if (write(resultFd, &total, sizeof(total)) != sizeof(total))
+	    _exit(1);
+	_exit(0);
+    }
+    return pid;
+}
+
+/**
+ * Attaches a cycle counter to pid that starts counting when pid calls
+ * exec().  Kernel cycles are included if we are allowed to count them,
+ * since the write() path is a large part of what is being measured.
+ */
+static int openCycleCounter(pid_t pid)
+{
+    struct perf_event_attr attr;
+    int                    fd = -1;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled       = 1;
+    attr.enable_on_exec = 1;
+    attr.exclude_hv     = 1;
+
+    fd = syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+    if (fd < 0) {
+	attr.exclude_kernel = 1;
+	fd = syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+    }
+    return fd;
+}
+
+/**
+ * Returns the number of read and write syscalls made by pid, or -1 if
+ * I/O accounting isn't available.
+ */
+static int64_t readSyscalls(pid_t pid)
+{
+    char     path[64];
+    char     line[128];
+    FILE    *fp    = NULL;
+    int64_t  total = -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/io", (int) pid);
+    if ((fp = fopen(path, "r")) == NULL)
+	return -1;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+	long long val = 0;
+	if (sscanf(line, "syscr: %lld", &val) == 1 ||
+		sscanf(line, "syscw: %lld", &val) == 1)
+	    total = (total < 0 ? 0 : total) + val;
+    }
+    fclose(fp);
+    return total;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
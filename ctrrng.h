@@ -0,0 +1,62 @@
+/* Counter-based random numbers, shared by part.c and shuffle.c.
+ *
+ * Instead of a state that is stepped forward, the i-th random number of a
+ * stream is just a hash of (key, i).  That gives O(1) access to any draw,
+ * which the stateless shuffles need because they replay the stream out of
+ * order.  The hash is the SplitMix64 finalizer applied to
+ * key + (i+1) * golden ratio, which is exactly what the SplitMix64 generator
+ * would output as its i-th number when seeded with key.
+ */
+#ifndef CTRRNG_H
+#define CTRRNG_H
+
+#include <stdint.h>
+
+#define CTR_GAMMA	UINT64_C(0x9e3779b97f4a7c15)
+
+static inline uint64_t ctrMix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+/**
+ * Returns the index-th 64-bit random number for the given key.
+ */
+static inline uint64_t ctrDraw(uint64_t key, uint64_t index)
+{
+    return ctrMix(key + (index + 1) * CTR_GAMMA);
+}
+
+/**
+ * Returns the index-th random number for the given key, reduced to
+ * 0..range-1 without bias.
+ *
+ * This uses Lemire's multiply and shift method.  The high 64 bits of
+ * x * range are the result.  A few values of x would make some results
+ * slightly more likely than others, and those are detected with the low
+ * 64 bits and rejected.  A rejected draw is replaced by rehashing it, so
+ * the result still only depends on (key, index) and stays randomly
+ * accessible.  Rejection happens with probability range / 2^64, so for
+ * realistic ranges the loop almost never runs.
+ */
+static inline uint64_t ctrBounded(uint64_t key, uint64_t index,
+				    uint64_t range)
+{
+    uint64_t          x = ctrDraw(key, index);
+    unsigned __int128 m = (unsigned __int128) x * range;
+    uint64_t          l = (uint64_t) m;
+
+    if (l < range) {
+	uint64_t threshold = -range % range;
+	while (l < threshold) {
+	    x = ctrMix(x + CTR_GAMMA);
+	    m = (unsigned __int128) x * range;
+	    l = (uint64_t) m;
+	}
+    }
+    return (uint64_t) (m >> 64);
+}
+
+#endif
@@ -0,0 +1,236 @@
+/* Buffered output of integers, shared by part.c and shuffle.c.
+ *
+ * printf() is too slow once the programs themselves are fast, so this
+ * collects output in a large buffer, converts integers to decimal two
+ * digits at a time, and flushes the buffer with write().
+ *
+ * There are four formats:
+ *
+ *   OUT_TEXT   - One decimal number per line.  A range is "first..last".
+ *   OUT_U32LE  - Each number as 4 bytes, little endian.  Only for numbers
+ *                below 2^32; see fastOutFits().
+ *   OUT_U64LE  - Each number as 8 bytes, little endian.
+ *   OUT_VARINT - Each number as a LEB128 varint (7 bits per byte, low bits
+ *                first, high bit set on every byte except the last).
+ *
+ * In the binary formats, a range is always written as two numbers, first
+ * and last, even if they are the same.
+ *
+ * A FastOut with fd < 0 is a memory buffer that just keeps growing, which
+ * is used for per-thread buffers that are later copied to the real output
+ * in order.
+ */
+#ifndef FASTOUT_H
+#define FASTOUT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FASTOUT_SIZE	(1 << 16)
+
+enum {
+    OUT_TEXT,
+    OUT_U32LE,
+    OUT_U64LE,
+    OUT_VARINT
+};
+
+typedef struct FastOut {
+    int     fd;
+    int     format;
+    char   *data;
+    size_t  len;
+    size_t  size;
+} FastOut;
+
+static const char fastOutDigits[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233"
+    "34353637383940414243444546474849505152535455565758596061626364656667"
+    "6869707172737475767778798081828384858687888990919293949596979899";
+
+/**
+ * Returns the format named by name, or -1 if there is no such format.
+ */
+static inline int fastOutFormat(const char *name)
+{
+    if (strcmp(name, "text") == 0)
+	return OUT_TEXT;
+    if (strcmp(name, "u32") == 0)
+	return OUT_U32LE;
+    if (strcmp(name, "u64") == 0)
+	return OUT_U64LE;
+    if (strcmp(name, "varint") == 0)
+	return OUT_VARINT;
+    return -1;
+}
+
+/**
+ * Returns nonzero if every number up to max can be written in format.
+ */
+static inline int fastOutFits(int format, uint64_t max)
+{
+    return format != OUT_U32LE || max <= UINT32_MAX;
+}
+
+static inline void fastOutInit(FastOut *out, int fd, int format)
+{
+    out->fd     = fd;
+    out->format = format;
+    out->len    = 0;
+    out->size   = FASTOUT_SIZE;
+    out->data   = malloc(out->size);
+    if (out->data == NULL) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+}
+
+static inline void fastOutFlush(FastOut *out)
+{
+    size_t done = 0;
+
+    if (out->fd < 0)
+	return;
+    while (done < out->len) {
+	ssize_t ret = write(out->fd, out->data + done, out->len - done);
+	if (ret <= 0) {
+	    perror("write");
+	    exit(1);
+	}
+	done += ret;
+    }
+    out->len = 0;
+}
+
+static inline void fastOutFree(FastOut *out)
+{
+    fastOutFlush(out);
+    free(out->data);
+    out->data = NULL;
+}
+
+/**
+ * Makes sure there is room for at least count more bytes, either by
+ * flushing or, for a memory buffer, by growing it.
+ */
+static inline void fastOutReserve(FastOut *out, size_t count)
+{
+    if (out->size - out->len >= count)
+	return;
+    if (out->fd >= 0) {
+	fastOutFlush(out);
+	if (out->size >= count)
+	    return;
+    }
+    while (out->size - out->len < count)
+	out->size *= 2;
+    out->data = realloc(out->data, out->size);
+    if (out->data == NULL) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+}
+
+static inline void fastOutBytes(FastOut *out, const void *data, size_t len)
+{
+    fastOutReserve(out, len);
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+/**
+ * Writes val in decimal to dst and returns the number of characters.  The
+ * digits are generated from right to left, two at a time, into a scratch
+ * area and then copied out.
+ */
+static inline int fastOutDecimal(char *dst, uint64_t val)
+{
+    char  tmp[20];
+    char *p = tmp + sizeof(tmp);
+    int   len;
+
+    while (val >= 100) {
+	unsigned pair = (unsigned) (val % 100) * 2;
+	val /= 100;
+	p -= 2;
+	p[0] = fastOutDigits[pair];
+	p[1] = fastOutDigits[pair + 1];
+    }
+    if (val >= 10) {
+	p -= 2;
+	p[0] = fastOutDigits[val * 2];
+	p[1] = fastOutDigits[val * 2 + 1];
+    } else {
+	*--p = '0' + (char) val;
+    }
+    len = tmp + sizeof(tmp) - p;
+    memcpy(dst, p, len);
+    return len;
+}
+
+/**
+ * Writes one number in the binary formats, or its digits (without a
+ * newline) in the text format.
+ */
+static inline void fastOutRaw(FastOut *out, uint64_t val)
+{
+    char *dst;
+    int   i;
+
+    fastOutReserve(out, 24);
+    dst = out->data + out->len;
+    switch (out->format) {
+	case OUT_U32LE:
+	    dst[0] = (char) val;
+	    dst[1] = (char) (val >> 8);
+	    dst[2] = (char) (val >> 16);
+	    dst[3] = (char) (val >> 24);
+	    out->len += 4;
+	    break;
+	case OUT_U64LE:
+	    for (i=0;i<8;i++)
+		dst[i] = (char) (val >> (8 * i));
+	    out->len += 8;
+	    break;
+	case OUT_VARINT:
+	    while (val >= 0x80) {
+		*dst++ = (char) (val | 0x80);
+		val >>= 7;
+		out->len++;
+	    }
+	    *dst = (char) val;
+	    out->len++;
+	    break;
+	default:
+	    out->len += fastOutDecimal(dst, val);
+	    break;
+    }
+}
+
+static inline void fastOutNum(FastOut *out, uint64_t val)
+{
+    fastOutRaw(out, val);
+    if (out->format == OUT_TEXT)
+	out->data[out->len++] = '\n';
+}
+
+static inline void fastOutRange(FastOut *out, uint64_t first, uint64_t last)
+{
+    if (out->format != OUT_TEXT) {
+	fastOutRaw(out, first);
+	fastOutRaw(out, last);
+	return;
+    }
+    if (first == last) {
+	fastOutNum(out, first);
+	return;
+    }
+    fastOutRaw(out, first);
+    fastOutBytes(out, "..", 2);
+    fastOutNum(out, last);
+}
+
+#endif
@@ -1,80 +1,228 @@
 /* Given two numbers N and M, partition the numbers 0..N randomly into groups
  * of size 1..M and output them (in random order).
+ *
+ * Usage: part [-k K] [-t THREADS] [-f FORMAT] [-r RNG] [-s SEED] N M
+ *
+ *   -k  Trades memory for time.  Normally nothing is stored, and finding
+ *       where a group starts means regenerating every group before it.
+ *       With K, a checkpoint is saved every K groups, so finding a group
+ *       only needs to regenerate at most K-1 groups.  K = 0 (the default)
+ *       means no checkpoints.
+ *   -t  Number of threads to generate the output with.
+ *   -f  Output format: text (the default), u32, u64 or varint.  See fastout.h.
+ *   -r  Random number generator: mwc (the default) or ctr.  The MWC rng only
+ *       handles N and M below 2^32.  The counter based rng in ctrrng.h
+ *       handles the full 64-bit range and also picks every random number
+ *       without bias, where mwc uses %.
+ *   -s  Seed.  The same seed (with the same rng) always gives the same
+ *       output.  The default is the current time.
+ *
+ * Build with -pthread.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "fastout.h"
+#include "ctrrng.h"
+
+#define MAX_THREADS	64
+#define THREAD_CHUNK	1024	// Output lines per thread per round
 
 typedef struct Seed {
     uint32_t seedW;
     uint32_t seedZ;
+    uint64_t key;         // Used instead of seedW and seedZ by the
+    uint64_t counter;     // counter based rng (-r ctr)
 } Seed;
 
-static uint32_t countGroups(const Seed *seedPart, uint32_t n, uint32_t m);
+// The state needed to resume partitioning at some group.
+typedef struct Checkpoint {
+    Seed     seed;
+    uint64_t cur;
+} Checkpoint;
+
+// Checkpoints for groups 0, every, 2*every, ...  If every is 0, there are
+// no checkpoints and groups are always found starting from group 0.
+typedef struct GroupIndex {
+    uint64_t    every;
+    uint64_t    numPoints;
+    uint64_t    maxPoints;
+    Checkpoint *points;
+} GroupIndex;
+
+// One thread's share of the output: positions first..last-1.
+typedef struct ShuffleJob {
+    const Seed       *seedPart;
+    const Seed       *seedShuffle;
+    const GroupIndex *index;
+    uint64_t          numGroups;
+    uint64_t          n;
+    uint64_t          m;
+    uint64_t          first;
+    uint64_t          last;
+    FastOut           out;    // Private memory buffer for this thread
+} ShuffleJob;
+
+static uint64_t countGroups(const Seed *seedPart, GroupIndex *index,
+				uint64_t n, uint64_t m);
 static void     shuffleGroups(const Seed *seedPart, const Seed *seedShuffle,
-				uint32_t numGroups, uint32_t n, uint32_t m);
-static void     printGroup(const Seed *seedPart, uint32_t groupIndex,
-				uint32_t n, uint32_t m);
+				const GroupIndex *index, uint64_t numGroups,
+				uint64_t n, uint64_t m, FastOut *out);
+static void     shuffleGroupsThreaded(const Seed *seedPart,
+				const Seed *seedShuffle, const GroupIndex *index,
+				uint64_t numGroups, uint64_t n, uint64_t m,
+				int numThreads, FastOut *out);
+static void    *shuffleThread(void *arg);
+static uint64_t pickGroup(const Seed *seedShuffle, uint64_t numGroups,
+				uint64_t i);
+static void     printGroup(const Seed *seedPart, const GroupIndex *index,
+				uint64_t groupIndex, uint64_t n, uint64_t m,
+				FastOut *out);
+static uint64_t rngRange(Seed *seed, uint64_t range);
 static uint32_t rng(Seed *seed);
-static void     skipN(Seed *seed, uint32_t numToSkip);
+static void     skipN(Seed *seed, uint64_t numToSkip);
+static uint32_t mwcJump(uint32_t state, uint32_t mult, uint64_t numToSkip);
+
+// Nonzero to use the counter based rng from ctrrng.h instead of the MWC
+// rng below.
+static int counterRng = 0;
 
 int main(int argc, char *argv[])
 {
-    uint32_t n           = 0;
-    uint32_t m           = 0;
-    uint32_t numGroups   = 0;
+    uint64_t n           = 0;
+    uint64_t m           = 0;
+    uint64_t numGroups   = 0;
     Seed     seedPart    = {0};   // Seed used to partition
     Seed     seedShuffle = {0};   // Seed used to shuffle
+    GroupIndex index     = {0};
+    int      numThreads  = 1;
+    int      format      = OUT_TEXT;
+    int      opt         = 0;
+    uint64_t seed        = time(NULL);
+    FastOut  out;
 
-    if (argc < 3) {
-	printf("Usage: part N M\n");
-	exit(0);
+    while ((opt = getopt(argc, argv, "k:t:f:r:s:")) != -1) {
+	switch (opt) {
+	    case 'k': index.every = strtoull(optarg, NULL, 0); break;
+	    case 't': numThreads  = atoi(optarg);              break;
+	    case 'f': format      = fastOutFormat(optarg);     break;
+	    case 's': seed        = strtoull(optarg, NULL, 0); break;
+	    case 'r':
+		if (strcmp(optarg, "ctr") == 0)
+		    counterRng = 1;
+		else if (strcmp(optarg, "mwc") != 0)
+		    goto usage;
+		break;
+	    default:  goto usage;
+	}
+    }
+    if (argc - optind < 2)
+	goto usage;
+    if (numThreads < 1 || numThreads > MAX_THREADS) {
+	printf("THREADS must be from 1..%d\n", MAX_THREADS);
+	exit(1);
+    }
+    if (format < 0) {
+	printf("FORMAT must be text, u32, u64 or varint\n");
+	exit(1);
     }
 
     // Get initial parameters.
-    n = atoi(argv[1]);
-    m = atoi(argv[2]);
+    n = strtoull(argv[optind], NULL, 0);
+    m = strtoull(argv[optind+1], NULL, 0);
+    if (m == 0) {
+	printf("M must be at least 1\n");
+	exit(1);
+    }
+    if (!counterRng && (n >= UINT32_MAX || m > UINT32_MAX)) {
+	printf("N and M must be below 2^32 unless -r ctr is used\n");
+	exit(1);
+    }
+    if (!fastOutFits(format, n)) {
+	printf("N must be below 2^32 for -f u32\n");
+	exit(1);
+    }
 
     // Generate the initial random seeds.
-    seedPart.seedW = (uint32_t) time(NULL);
+    seedPart.seedW = (uint32_t) seed;
     seedPart.seedZ = ~seedPart.seedW;
     seedShuffle.seedW = rng(&seedPart);
     seedShuffle.seedZ = rng(&seedPart);
+    seedPart.key      = ctrMix(seed);
+    seedShuffle.key   = ctrMix(seedPart.key);
 
     // Count the number of groups we will need.
-    numGroups = countGroups(&seedPart, n, m);
+    numGroups = countGroups(&seedPart, &index, n, m);
 
 #if 0
     {
-	int i = 0;
-	printf("Split %d into %d groups of max size %d\n", n, numGroups, m);
+	uint64_t i = 0;
+	printf("Split %llu into %llu groups of max size %llu\n",
+		(unsigned long long) n, (unsigned long long) numGroups,
+		(unsigned long long) m);
 	for (i=0;i<numGroups;i++) {
-	    printGroup(&seedPart, i, n, m);
+	    printGroup(&seedPart, &index, i, n, m, &out);
 	}
     }
 #endif
 
     // Now shuffle the groups without maintaining any state.
-    shuffleGroups(&seedPart, &seedShuffle, numGroups, n, m);
+    fastOutInit(&out, STDOUT_FILENO, format);
+    if (numThreads == 1) {
+	shuffleGroups(&seedPart, &seedShuffle, &index, numGroups, n, m, &out);
+    } else {
+	shuffleGroupsThreaded(&seedPart, &seedShuffle, &index, numGroups,
+				n, m, numThreads, &out);
+    }
+    fastOutFree(&out);
 
+    free(index.points);
     return 0;
+
+usage:
+    printf("Usage: part [-k K] [-t THREADS] [-f text|u32|u64|varint] "
+	    "[-r mwc|ctr] [-s SEED] N M\n");
+    exit(0);
 }
 
 /**
  * Partitions the numbers 0..N into random groups of size 1..M and returns
- * a count of the number of partitions.
+ * a count of the number of partitions.  If index->every is nonzero, this
+ * also saves a checkpoint every index->every groups.
  */
-static uint32_t countGroups(const Seed *seedPart, uint32_t n, uint32_t m)
+static uint64_t countGroups(const Seed *seedPart, GroupIndex *index,
+				uint64_t n, uint64_t m)
 {
     Seed     seed      = *seedPart;
-    uint32_t count     = 0;
-    uint32_t cur       = 0;
-    uint32_t groupSize = 0;
+    uint64_t count     = 0;
+    uint64_t cur       = 0;
+    uint64_t groupSize = 0;
 
     for (cur = 0; cur <= n; cur += groupSize) {
-	groupSize = (rng(&seed) % m) + 1;
+	if (index->every != 0 && count % index->every == 0) {
+	    if (index->numPoints == index->maxPoints) {
+		index->maxPoints = index->maxPoints ? 2 * index->maxPoints : 64;
+		index->points    = realloc(index->points,
+					index->maxPoints * sizeof(Checkpoint));
+		if (index->points == NULL) {
+		    fprintf(stderr, "Not enough memory.\n");
+		    exit(1);
+		}
+	    }
+	    index->points[index->numPoints].seed = seed;
+	    index->points[index->numPoints].cur  = cur;
+	    index->numPoints++;
+	}
+	groupSize = rngRange(&seed, m) + 1;
 	count++;
+
+	// Stop here if cur + groupSize would wrap around past 2^64-1.
+	if (groupSize > n - cur)
+	    break;
     }
     return count;
 }
@@ -146,69 +294,166 @@ static uint32_t countGroups(const Seed *seedPart, uint32_t n, uint32_t m)
  * linear fashion.
  */
 static void shuffleGroups(const Seed *seedPart, const Seed *seedShuffle,
-			    uint32_t numGroups, uint32_t n, uint32_t m)
+			    const GroupIndex *index, uint64_t numGroups,
+			    uint64_t n, uint64_t m, FastOut *out)
 {
-    Seed seed = *seedShuffle;
-    int  i    = 0;
-    int  j    = 0;
+    uint64_t i = 0;
 
     for (i=0;i<numGroups;i++) {
-	int groupIndex  = 0;
-	
-	// The 0th groupIndex comes from the last random number in the sequence.
-	// So here, we skip forward to the correct spot in the sequence.
-	seed = *seedShuffle;
-	skipN(&seed, numGroups - i - 1);
-
-	// Select a number from [i..numGroups-1].  This is "r" in the
-	// explanation above.
-	groupIndex = i + (rng(&seed) % (numGroups - i));
-
-	// Adjust the random index by examining all previously picked indices.
-	for (j=i-1;j>=0;j--) {
-	    int r = j + (rng(&seed) % (numGroups - j));
-
-	    // Every time we see the slot we are looking for, we switch
-	    // to looking for slot j instead.
-	    if (r == groupIndex)
-		groupIndex = j;
-	}
+	uint64_t groupIndex = pickGroup(seedShuffle, numGroups, i);
 
 	// printf("%d) Picked group %d\n", i, groupIndex);
-	printGroup(seedPart, groupIndex, n, m);
+	printGroup(seedPart, index, groupIndex, n, m, out);
+    }
+}
+
+/**
+ * Returns the group that ends up at position i of the shuffle.  Nothing
+ * here depends on any other position, so positions can be computed in any
+ * order, or in parallel.
+ */
+static uint64_t pickGroup(const Seed *seedShuffle, uint64_t numGroups,
+			    uint64_t i)
+{
+    Seed     seed       = *seedShuffle;
+    uint64_t groupIndex = 0;
+    uint64_t j          = 0;
+
+    // The 0th groupIndex comes from the last random number in the sequence.
+    // So here, we skip forward to the correct spot in the sequence.
+    skipN(&seed, numGroups - i - 1);
+
+    // Select a number from [i..numGroups-1].  This is "r" in the
+    // explanation above.
+    groupIndex = i + rngRange(&seed, numGroups - i);
+
+    // Adjust the random index by examining all previously picked indices.
+    for (j=i;j-->0;) {
+	uint64_t r = j + rngRange(&seed, numGroups - j);
+
+	// Every time we see the slot we are looking for, we switch
+	// to looking for slot j instead.
+	if (r == groupIndex)
+	    groupIndex = j;
+    }
+    return groupIndex;
+}
+
+/**
+ * Same as shuffleGroups(), but split across numThreads threads.  The output
+ * is generated in rounds.  In each round, every thread takes the next
+ * THREAD_CHUNK positions and formats them into its own buffer.  Once all
+ * the threads are done, the buffers are written out in order.  Since
+ * skipN() is O(log n), a thread can start anywhere in the sequence without
+ * having to step through the part before it.
+ */
+static void shuffleGroupsThreaded(const Seed *seedPart,
+				    const Seed *seedShuffle,
+				    const GroupIndex *index,
+				    uint64_t numGroups, uint64_t n, uint64_t m,
+				    int numThreads, FastOut *out)
+{
+    ShuffleJob jobs[MAX_THREADS];
+    pthread_t  threads[MAX_THREADS];
+    uint64_t   pos = 0;
+    int        t   = 0;
+
+    memset(jobs, 0, sizeof(jobs));
+    for (t=0;t<numThreads;t++) {
+	jobs[t].seedPart    = seedPart;
+	jobs[t].seedShuffle = seedShuffle;
+	jobs[t].index       = index;
+	jobs[t].numGroups   = numGroups;
+	jobs[t].n           = n;
+	jobs[t].m           = m;
+	fastOutInit(&jobs[t].out, -1, out->format);
+    }
+
+    while (pos < numGroups) {
+	int started = 0;
+
+	for (t=0;t<numThreads && pos<numGroups;t++) {
+	    jobs[t].first   = pos;
+	    jobs[t].last    = (numGroups - pos > THREAD_CHUNK) ?
+				pos + THREAD_CHUNK : numGroups;
+	    jobs[t].out.len = 0;
+	    pos = jobs[t].last;
+	    if (pthread_create(&threads[t], NULL, shuffleThread, &jobs[t])) {
+		fprintf(stderr, "Couldn't create thread.\n");
+		exit(1);
+	    }
+	    started++;
+	}
+	for (t=0;t<started;t++) {
+	    pthread_join(threads[t], NULL);
+	    fastOutBytes(out, jobs[t].out.data, jobs[t].out.len);
+	}
+    }
+
+    for (t=0;t<numThreads;t++)
+	fastOutFree(&jobs[t].out);
+}
+
+static void *shuffleThread(void *arg)
+{
+    ShuffleJob *job = arg;
+    uint64_t    i   = 0;
+
+    for (i=job->first;i<job->last;i++) {
+	uint64_t groupIndex = pickGroup(job->seedShuffle, job->numGroups, i);
+	printGroup(job->seedPart, job->index, groupIndex, job->n, job->m,
+		    &job->out);
     }
+    return NULL;
 }
 
 /**
  * This is similar to countGroups() except that it stops at the given
- * groupIndex and prints the group out.
+ * groupIndex and prints the group out.  If there is a checkpoint index,
+ * it starts from the nearest checkpoint before groupIndex instead of from
+ * group 0.
  */
-static void printGroup(const Seed *seedPart, uint32_t groupIndex,
-			    uint32_t n, uint32_t m)
+static void printGroup(const Seed *seedPart, const GroupIndex *index,
+			    uint64_t groupIndex, uint64_t n, uint64_t m,
+			    FastOut *out)
 {
     Seed     seed      = *seedPart;
-    uint32_t count     = 0;
-    uint32_t cur       = 0;
-    uint32_t groupSize = 0;
+    uint64_t count     = 0;
+    uint64_t cur       = 0;
+    uint64_t groupSize = 0;
+
+    if (index->every != 0) {
+	const Checkpoint *cp = &index->points[groupIndex / index->every];
+
+	seed  = cp->seed;
+	cur   = cp->cur;
+	count = groupIndex - groupIndex % index->every;
+    }
 
     // Skip over all groups up to the one we want.
-    for (cur = 0; count < groupIndex; cur += groupSize) {
-	groupSize = (rng(&seed) % m) + 1;
+    for (; count < groupIndex; cur += groupSize) {
+	groupSize = rngRange(&seed, m) + 1;
 	count++;
     }
 
     // Get the last group size.
-    groupSize = (rng(&seed) % m) + 1;
+    groupSize = rngRange(&seed, m) + 1;
 
     // Handle special case of the last group exceeding N.
-    if (cur + groupSize > n)
+    if (groupSize > n - cur)
 	groupSize = n - cur + 1;
 
-    if (groupSize == 1) {
-	printf("%d\n", cur);
-    } else {
-	printf("%d..%d\n", cur, cur + groupSize - 1);
-    }
+    fastOutRange(out, cur, cur + groupSize - 1);
+}
+
+/**
+ * Returns the next random number from 0..range-1.
+ */
+static uint64_t rngRange(Seed *seed, uint64_t range)
+{
+    if (counterRng)
+	return ctrBounded(seed->key, seed->counter++, range);
+    return rng(seed) % range;
 }
 
 /**
@@ -228,13 +473,54 @@ static uint32_t rng(Seed *seed)
 }
 
 /**
- * Skips N rng numbers in the sequence.
+ * Skips N rng numbers in the sequence.  This takes O(log N) time instead of
+ * stepping the rng N times.  See mwcJump() for how.  The counter based rng
+ * just moves its counter.
  */
-static void skipN(Seed *seed, uint32_t numToSkip)
+static void skipN(Seed *seed, uint64_t numToSkip)
 {
-    uint32_t i;
-
-    for (i=0;i<numToSkip;i++)
-	rng(seed);
+    if (counterRng) {
+	seed->counter += numToSkip;
+	return;
+    }
+    seed->seedW = mwcJump(seed->seedW, 18000, numToSkip);
+    seed->seedZ = mwcJump(seed->seedZ, 36969, numToSkip);
 }
 
+/**
+ * Advances one 16-bit multiply with carry generator by numToSkip steps.
+ *
+ * One step takes state = carry * 2^16 + x to mult * x + carry.  If we let
+ * p = mult * 2^16 - 1, then mult * state = mult * carry * 2^16 + mult * x,
+ * and since mult * 2^16 == 1 (mod p), that is the same as the next state
+ * (mod p).  So each step just multiplies the state by mult mod p, and
+ * skipping N steps multiplies it by mult^N mod p, which we can compute
+ * with repeated squaring.
+ *
+ * This only works while the state is a number from 0..p.  Any state that
+ * is reachable after a step is in that range, but the initial seed may not
+ * be, so we take up to two real steps to get there first.  The states 0 and
+ * p are both fixed points of the generator and are left alone.
+ */
+static uint32_t mwcJump(uint32_t state, uint32_t mult, uint64_t numToSkip)
+{
+    uint64_t p      = ((uint64_t) mult << 16) - 1;
+    uint64_t result = 0;
+    uint64_t base   = mult;
+
+    while (numToSkip > 0 && state > p) {
+	state = mult * (state & 65535) + (state >> 16);
+	numToSkip--;
+    }
+    if (state % p == 0)
+	return state;
+
+    result = state;
+    while (numToSkip > 0) {
+	if (numToSkip & 1)
+	    result = (result * base) % p;
+	base = (base * base) % p;
+	numToSkip >>= 1;
+    }
+    return (uint32_t) result;
+}
@@ -0,0 +1,280 @@
+// Answers many queries for the problem in permute.c in one pass over the
+// binary table written by "gentable -b".
+//
+// Usage: batch [-j THREADS] [-t TABLE] < queries
+//
+// The input is any number of queries in the format permute.c reads, one
+// after the other: a count N followed by N divisors.  For each query, in
+// order, the lowest X is printed, or "Not found".
+//
+// The classes are walked once, and each class is tested against every
+// query that doesn't have an answer yet.  Whether a divisor divides some
+// permutation of the class is worked out once per class and shared by all
+// of the queries that have that divisor.  A query retires as soon as it is
+// answered, so later classes skip it.
+//
+// With threads, the class list is cut into chunks that the threads take in
+// increasing order.  A query can be answered by several threads at once,
+// but the answer is the lowest class, so each query keeps the lowest class
+// found so far in an atomic, which only ever goes down.  A thread skips
+// queries whose answer is already below the chunk it is working on, and
+// stops when every query has an answer below its next chunk.
+//
+// Build with:
+//
+// cc -O2 -pthread batch.c -o batch
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "divisor.h"
+#include "ptable.h"
+
+#define MAX_THREADS	256
+#define CHUNK_CLASSES	256		// Classes a thread takes at a time
+#define NO_CLASS	UINT64_MAX
+
+typedef struct Query {
+    int                *divs;	// Indexes into the shared divisor list
+    int                 count;
+    _Atomic uint64_t    best;	// Lowest class that answers it so far
+} Query;
+
+typedef struct Shared {
+    const PTable       *table;
+    Query              *queries;
+    int                 numQueries;
+    const Divisor      *divisors;
+    int                 numDivisors;
+    _Atomic uint64_t    nextChunk;
+} Shared;
+
+static void    *searchThread(void *arg);
+static int      readQueries(Shared *sh);
+static int      compareU64(const void *a, const void *b);
+
+int main(int argc, char *argv[])
+{
+    const char *path       = "table.bin";
+    pthread_t   threads[MAX_THREADS];
+    PTable      table;
+    Shared      sh;
+    uint64_t    first      = 0;
+    int         numThreads = 1;
+    int         opt        = 0;
+    int         i;
+
+    while ((opt = getopt(argc, argv, "j:t:")) != -1) {
+	switch (opt) {
+	    case 'j': numThreads = atoi(optarg); break;
+	    case 't': path       = optarg;       break;
+	    default:  goto usage;
+	}
+    }
+    if (numThreads < 1 || numThreads > MAX_THREADS)
+	goto usage;
+
+    if (ptableOpen(&table, path) < 0) {
+	fprintf(stderr, "%s: not a permutation table\n", path);
+	return 1;
+    }
+    sh.table = &table;
+    if (readQueries(&sh) < 0)
+	goto usage;
+    atomic_init(&sh.nextChunk, 0);
+
+    // The chunks are shared out through nextChunk, so if a thread can't be
+    // started, the ones that did start just do more of them.
+    for (i=1;i<numThreads;i++) {
+	if (pthread_create(&threads[i], NULL, searchThread, &sh) != 0)
+	    break;
+    }
+    numThreads = i;
+    searchThread(&sh);
+    for (i=1;i<numThreads;i++)
+	pthread_join(threads[i], NULL);
+
+    for (i=0;i<sh.numQueries;i++) {
+	uint64_t best = atomic_load(&sh.queries[i].best);
+
+	if (best == NO_CLASS) {
+	    printf("Not found\n");
+	} else {
+	    ptableClass(&table, best, &first, 1);
+	    printf("%llu\n", (unsigned long long) first);
+	}
+    }
+    ptableClose(&table);
+    return 0;
+
+usage:
+    printf("Usage: batch [-j THREADS] [-t TABLE] < queries\n");
+    exit(1);
+}
+
+static void *searchThread(void *arg)
+{
+    Shared   *sh      = arg;
+    uint64_t *perms   = NULL;
+    uint64_t *stamp   = calloc(sh->numDivisors, sizeof(uint64_t));
+    char     *hit     = malloc(sh->numDivisors);
+    int      *active  = malloc(sh->numQueries * sizeof(int));
+    int       size    = 0;
+    int       i, j, k;
+
+    for (;;) {
+	uint64_t start = atomic_fetch_add(&sh->nextChunk, 1) * CHUNK_CLASSES;
+	uint64_t end   = start + CHUNK_CLASSES;
+	uint64_t c;
+	int      numActive = 0;
+
+	if (start >= sh->table->numClasses)
+	    break;
+	if (end > sh->table->numClasses)
+	    end = sh->table->numClasses;
+
+	// Only queries without an answer before this chunk matter.  The
+	// chunks are handed out in order, so once there are none, no later
+	// chunk can matter either.
+	for (i=0;i<sh->numQueries;i++) {
+	    if (atomic_load_explicit(&sh->queries[i].best,
+			memory_order_relaxed) > start)
+		active[numActive++] = i;
+	}
+	if (numActive == 0)
+	    break;
+
+	for (c=start;c<end && numActive>0;c++) {
+	    int count = ptableClass(sh->table, c, perms, size);
+
+	    if (count > size) {
+		size  = count;
+		perms = realloc(perms, size * sizeof(uint64_t));
+		ptableClass(sh->table, c, perms, size);
+	    }
+
+	    for (i=0;i<numActive;i++) {
+		Query *q = &sh->queries[active[i]];
+
+		if (atomic_load_explicit(&q->best, memory_order_relaxed) <= c) {
+		    active[i--] = active[--numActive];
+		    continue;
+		}
+
+		// The stamp says whether hit[] for this divisor is from
+		// this class; c + 1 so that the zeroed stamps never match.
+		for (j=0;j<q->count;j++) {
+		    int d = q->divs[j];
+
+		    if (stamp[d] != c + 1) {
+			stamp[d] = c + 1;
+			hit[d]   = 0;
+			for (k=0;k<count;k++) {
+			    if (divides(&sh->divisors[d], perms[k])) {
+				hit[d] = 1;
+				break;
+			    }
+			}
+		    }
+		    if (!hit[d])
+			break;
+		}
+		if (j < q->count)
+		    continue;
+
+		// Answered by this class.  Lower the best class found so far
+		// unless another thread already found a lower one.
+		{
+		    uint64_t best = atomic_load(&q->best);
+		    while (c < best &&
+			    !atomic_compare_exchange_weak(&q->best, &best, c))
+			;
+		}
+		active[i--] = active[--numActive];
+	    }
+	}
+    }
+
+    free(active);
+    free(hit);
+    free(stamp);
+    free(perms);
+    return NULL;
+}
+
+// Reads all of the queries, and gives every distinct divisor one slot in
+// the shared divisor list.  Returns -1 on bad input.
+static int readQueries(Shared *sh)
+{
+    uint64_t *all     = NULL;	// Every divisor of every query, in order
+    uint64_t *unique  = NULL;
+    Divisor  *divs    = NULL;
+    int       numAll  = 0;
+    int       sizeAll = 0;
+    int       n, i, j;
+
+    sh->queries    = NULL;
+    sh->numQueries = 0;
+    while (scanf("%d", &n) == 1) {
+	Query *q;
+
+	if (n < 0)
+	    return -1;
+	sh->queries = realloc(sh->queries,
+				(sh->numQueries + 1) * sizeof(Query));
+	q        = &sh->queries[sh->numQueries++];
+	q->count = n;
+	q->divs  = malloc((n + 1) * sizeof(int));
+	atomic_init(&q->best, NO_CLASS);
+	if (numAll + n > sizeAll) {
+	    sizeAll = (numAll + n) * 2;
+	    all     = realloc(all, sizeAll * sizeof(uint64_t));
+	}
+	for (i=0;i<n;i++) {
+	    unsigned long long d;
+	    if (scanf("%llu", &d) != 1 || d == 0)
+		return -1;
+	    all[numAll++] = d;
+	}
+    }
+
+    // Sort a copy of the divisors and drop the duplicates.
+    unique = malloc((numAll + 1) * sizeof(uint64_t));
+    memcpy(unique, all, numAll * sizeof(uint64_t));
+    qsort(unique, numAll, sizeof(uint64_t), compareU64);
+    for (i=0, j=0;i<numAll;i++) {
+	if (j == 0 || unique[i] != unique[j-1])
+	    unique[j++] = unique[i];
+    }
+    sh->numDivisors = j;
+    divs = malloc((j + 1) * sizeof(Divisor));
+    for (i=0;i<j;i++)
+	initDivisor(&divs[i], unique[i]);
+    sh->divisors = divs;
+
+    // Point each query at the slots of its divisors.
+    for (i=0, n=0;i<sh->numQueries;i++) {
+	Query *q = &sh->queries[i];
+
+	for (j=0;j<q->count;j++) {
+	    const uint64_t *slot = bsearch(&all[n++], unique, sh->numDivisors,
+					    sizeof(uint64_t), compareU64);
+	    q->divs[j] = slot - unique;
+	}
+    }
+    free(unique);
+    free(all);
+    return 0;
+}
+
+static int compareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
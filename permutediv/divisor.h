@@ -0,0 +1,49 @@
+// Divisibility test by multiplication, shared by permrt.c and batch.c.
+//
+// With d = 2^shift * odd, n is a multiple of d exactly when
+// n * odd^-1 (mod 2^64), rotated right by shift, is at most UINT64_MAX / d.
+// That is one multiply instead of a division, once the inverse is known.
+#ifndef DIVISOR_H
+#define DIVISOR_H
+
+#include <stdint.h>
+
+typedef struct Divisor {
+    uint64_t d;
+    uint64_t inverse;	// Inverse of the odd part of d, mod 2^64
+    uint64_t limit;	// UINT64_MAX / d
+    int      shift;	// Number of trailing zero bits of d
+} Divisor;
+
+// Sets up the test for d, which must not be 0.  The inverse is found with
+// Newton's iteration, which doubles the number of correct low bits each
+// time: odd is its own inverse mod 8, so 5 more steps give all 64 bits.
+static inline void initDivisor(Divisor *div, uint64_t d)
+{
+    uint64_t odd = d;
+    uint64_t inv = 0;
+    int      i;
+
+    div->d     = d;
+    div->shift = 0;
+    while ((odd & 1) == 0) {
+	odd >>= 1;
+	div->shift++;
+    }
+    inv = odd;
+    for (i=0;i<5;i++)
+	inv *= 2 - odd * inv;
+    div->inverse = inv;
+    div->limit   = UINT64_MAX / d;
+}
+
+static inline int divides(const Divisor *div, uint64_t n)
+{
+    uint64_t q = n * div->inverse;
+
+    if (div->shift != 0)
+	q = (q >> div->shift) | (q << (64 - div->shift));
+    return q <= div->limit;
+}
+
+#endif
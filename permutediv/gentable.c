@@ -23,49 +23,296 @@
 //
 // You can then compile permute.c, which includes table.h.
 //
+// With -b, the table is written in the binary format from ptable.h instead,
+// which permute.c can mmap at run time when built with -DUSE_BINARY_TABLE:
+//
+// ./gentable -b > table.bin
+//
+// Usage: gentable [-b] [-n BOUND] [-j THREADS]
+//
+// -n makes a table of the numbers below BOUND (up to 10^12) instead of
+// 1000000, and the sentinel is then -BOUND.  -j spreads the work over
+// THREADS threads.  Build with -pthread.
+//
+// Nothing is sorted or looked up.  The signatures (lowest numbers) of the
+// classes are listed in increasing order directly, and the numbers of each
+// class are generated in increasing order from its signature, both with
+// signature.h.  Every number costs one next_permutation step.  The text
+// table is streamed, so its memory only grows with the number of classes,
+// which is tiny next to the bound.  The binary table can't be: its offsets
+// come before the data in the file, so -b keeps the whole data section in
+// memory until the end (about 150 MB for a bound of 10^8).
+// The classes are handed out to the threads in rounds of ROUND_CLASSES
+// each; every thread formats its classes into its own buffer, and the
+// buffers are written out in order at the end of each round.
+//
 #include <stdio.h>
 #include <stdlib.h>
-#define MAX 1000000
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ptable.h"
+#include "signature.h"
+
+#define MAX_DIGITS	12
+#define MAX_THREADS	256
+#define ROUND_CLASSES	4096		// Classes per thread per round
+
+typedef struct Buffer {
+    char   *data;
+    size_t  len;
+    size_t  size;
+} Buffer;
 
-int nums[MAX];
-int *permutations[MAX];
-int permCount[MAX];
+typedef struct Job {
+    const uint64_t *signatures;
+    uint64_t        first;		// Range of classes to do
+    uint64_t        last;
+    uint64_t        bound;
+    int             binary;
+    Buffer          out;
+    uint64_t       *sizes;		// Binary: bytes of each class
+} Job;
 
-int main()
+static uint64_t *listSignatures(uint64_t bound, uint64_t *count);
+static void     *classThread(void *arg);
+static void      reserve(Buffer *buf, size_t count);
+static int       putDecimal(char *dst, uint64_t val);
+
+int main(int argc, char *argv[])
 {
-    int i;
-
-    for (i=0;i<MAX;i++) {
-        int num=i;
-        int j;
-        int p[10] = {0};
-        while (num>0) {p[num%10]++; num/=10;}
-
-        for(j=1;j<10;j++) if(p[j]>0) {num=j; p[j]--; break;}
-        for(j=0;j<10;j++) while (p[j]>0) {num=10*num+j; p[j]--;}
-
-        // i -> num
-        if (permutations[num] == NULL) {
-            if (num >= 100000)
-                permutations[num] = (int *) calloc(720, sizeof(int));
-            else if (num >= 10000)
-                permutations[num] = (int *) calloc(120, sizeof(int));
-            else
-                permutations[num] = (int *) calloc(24, sizeof(int));
+    Job        jobs[MAX_THREADS];
+    pthread_t  threads[MAX_THREADS];
+    int        started[MAX_THREADS];
+    Buffer     data       = {0};
+    uint64_t  *offsets    = NULL;
+    uint64_t  *signatures = NULL;
+    uint64_t   bound      = 1000000;
+    uint64_t   numClasses = 0;
+    uint64_t   pos        = 0;
+    int        binary     = 0;
+    int        numThreads = 1;
+    int        opt        = 0;
+    int        t;
+
+    while ((opt = getopt(argc, argv, "bn:j:")) != -1) {
+        switch (opt) {
+            case 'b': binary     = 1;                          break;
+            case 'n': bound      = strtoull(optarg, NULL, 0);  break;
+            case 'j': numThreads = atoi(optarg);               break;
+            default:  goto usage;
         }
-        // Append permutation.
-        permutations[num][permCount[num]++] = i;
     }
-    for (i=1;i<MAX;i++) {
-        int j;
-        if (permutations[i] != NULL) {
-            printf("-%d, ", i);
-            for (j=1;j<permCount[i];j++) {
-                printf("%d, ", permutations[i][j]);
+    if (bound < 2 || bound > 1000000000000ULL || numThreads < 1 ||
+            numThreads > MAX_THREADS)
+        goto usage;
+
+    signatures = listSignatures(bound, &numClasses);
+    if (binary) {
+        offsets = malloc((numClasses + 1) * sizeof(uint64_t));
+        if (offsets == NULL) {
+            fprintf(stderr, "Not enough memory.\n");
+            exit(1);
+        }
+        offsets[0] = 0;
+    }
+    for (t=0;t<numThreads;t++) {
+        memset(&jobs[t], 0, sizeof(jobs[t]));
+        jobs[t].signatures = signatures;
+        jobs[t].bound      = bound;
+        jobs[t].binary     = binary;
+        jobs[t].sizes      = malloc(ROUND_CLASSES * sizeof(uint64_t));
+        if (jobs[t].sizes == NULL) {
+            fprintf(stderr, "Not enough memory.\n");
+            exit(1);
+        }
+    }
+
+    while (pos < numClasses) {
+        int used = 0;
+
+        for (t=0;t<numThreads && pos<numClasses;t++) {
+            jobs[t].first = pos;
+            jobs[t].last  = (numClasses - pos > ROUND_CLASSES) ?
+                                pos + ROUND_CLASSES : numClasses;
+            pos = jobs[t].last;
+            used++;
+        }
+        for (t=1;t<used;t++)
+            started[t] = pthread_create(&threads[t], NULL, classThread,
+                                        &jobs[t]) == 0;
+        classThread(&jobs[0]);
+        // A job whose thread couldn't be started is done here instead.
+        for (t=1;t<used;t++) {
+            if (started[t])
+                pthread_join(threads[t], NULL);
+            else
+                classThread(&jobs[t]);
+        }
+
+        for (t=0;t<used;t++) {
+            Job      *job = &jobs[t];
+            uint64_t  k;
+
+            if (!binary) {
+                fwrite(job->out.data, 1, job->out.len, stdout);
+                continue;
             }
-            printf("\n");
+            for (k=job->first;k<job->last;k++)
+                offsets[k+1] = offsets[k] + job->sizes[k - job->first];
+            reserve(&data, job->out.len);
+            memcpy(data.data + data.len, job->out.data, job->out.len);
+            data.len += job->out.len;
+        }
+    }
+
+    if (binary) {
+        if (numClasses == 0)
+            reserve(&data, 1);
+        if (ptableWrite(stdout, bound, numClasses, offsets,
+                    (unsigned char *) data.data) < 0) {
+            perror("write");
+            exit(1);
         }
+    } else {
+        printf("-%llu\n", (unsigned long long) bound);
+    }
+    if (fflush(stdout) != 0) {
+        perror("write");
+        exit(1);
     }
-    printf("-%d\n", MAX);
     return 0;
+
+usage:
+    printf("Usage: gentable [-b] [-n BOUND] [-j THREADS]\n");
+    exit(1);
+}
+
+// Returns the signatures of all classes below bound, in increasing order.
+static uint64_t *listSignatures(uint64_t bound, uint64_t *count)
+{
+    uint64_t *list  = NULL;
+    uint64_t  size  = 0;
+    uint64_t  n     = 0;
+    int       digits[MAX_DIGITS];
+    int       len, i;
+
+    for (len=1;len<=MAX_DIGITS;len++) {
+        digits[0] = 1;
+        for (i=1;i<len;i++)
+            digits[i] = 0;
+        do {
+            uint64_t x = 0;
+
+            for (i=0;i<len;i++)
+                x = x * 10 + digits[i];
+            if (x >= bound)
+                goto done;
+            if (n == size) {
+                size = size ? size * 2 : 1024;
+                list = realloc(list, size * sizeof(uint64_t));
+                if (list == NULL) {
+                    fprintf(stderr, "Not enough memory.\n");
+                    exit(1);
+                }
+            }
+            list[n++] = x;
+        } while (nextSignature(digits, len));
+    }
+done:
+    *count = n;
+    return list;
+}
+
+// Formats the classes job->first .. job->last - 1 into job->out, either as
+// text lines or as the varints of ptable.h.
+static void *classThread(void *arg)
+{
+    Job      *job = arg;
+    uint64_t  k;
+
+    job->out.len = 0;
+    for (k=job->first;k<job->last;k++) {
+        uint64_t prefix[MAX_DIGITS+1];
+        uint64_t value;
+        uint64_t prev  = 0;
+        size_t   start = job->out.len;
+        int      digits[MAX_DIGITS];
+        int      len   = 0;
+        int      from  = 0;
+        int      i;
+
+        for (value=job->signatures[k]; value>0; value/=10)
+            len++;
+        for (value=job->signatures[k], i=len-1; i>=0; value/=10, i--)
+            digits[i] = value % 10;
+
+        prefix[0] = 0;
+        do {
+            for (i=from;i<len;i++)
+                prefix[i+1] = prefix[i] * 10 + digits[i];
+            value = prefix[len];
+            if (value >= job->bound)
+                break;
+
+            reserve(&job->out, 24);
+            if (job->binary) {
+                job->out.len += ptablePutVarint(
+                        (unsigned char *) job->out.data + job->out.len,
+                        value - prev);
+            } else {
+                char *dst = job->out.data + job->out.len;
+                int   n   = 0;
+
+                if (value == job->signatures[k])
+                    dst[n++] = '-';
+                n += putDecimal(dst + n, value);
+                dst[n++] = ',';
+                dst[n++] = ' ';
+                job->out.len += n;
+            }
+            prev = value;
+        } while ((from = nextPermutation(digits, len)) >= 0);
+
+        if (job->binary) {
+            job->sizes[k - job->first] = job->out.len - start;
+        } else {
+            reserve(&job->out, 1);
+            job->out.data[job->out.len++] = '\n';
+        }
+    }
+    return NULL;
+}
+
+// Makes sure there is room for count more bytes.
+static void reserve(Buffer *buf, size_t count)
+{
+    if (buf->size - buf->len >= count)
+        return;
+    if (buf->size == 0)
+        buf->size = 1 << 16;
+    while (buf->size - buf->len < count)
+        buf->size *= 2;
+    buf->data = realloc(buf->data, buf->size);
+    if (buf->data == NULL) {
+        fprintf(stderr, "Not enough memory.\n");
+        exit(1);
+    }
+}
+
+// Writes val in decimal to dst and returns the number of characters.
+static int putDecimal(char *dst, uint64_t val)
+{
+    char tmp[20];
+    int  n = 0;
+    int  i;
+
+    do {
+        tmp[n++] = '0' + val % 10;
+        val /= 10;
+    } while (val > 0);
+    for (i=0;i<n;i++)
+        dst[i] = tmp[n-1-i];
+    return n;
 }
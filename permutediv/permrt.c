@@ -0,0 +1,321 @@
+// This solves the same problem as permute.c:
+//
+// http://codereview.stackexchange.com/questions/108074/optimize-program-to-test-for-divisibility-of-numbers-3-0
+//
+// Given an input of several integers, find the lowest number X such that
+// each of the input numbers divides into at least one of the permutations of
+// X.  A permutation of X is a number that is a permutation of the digits of
+// X (with no leading zeroes allowed).
+//
+// Instead of the table from gentable.c, this generates the permutation
+// classes as it goes, so there is nothing to precompute and the bound is not
+// fixed at 10^6.  Numbers with the same digits form a class, and the lowest
+// number of a class (its "signature") is its smallest nonzero digit followed
+// by the rest of its digits in increasing order.  For example, the class of
+// 210 has signature 102.  The signatures of each length can be listed in
+// increasing order directly: pick the first digit f, and then the remaining
+// digits are a nondecreasing run of digits that are each 0 or at least f.
+// Since the answer is always the signature of some class, the first class
+// that works is the answer.
+//
+// The permutations of a class are generated with next_permutation, starting
+// from the signature.  Every permutation with a leading zero sorts before
+// the signature, so this gives exactly the valid ones, in increasing order.
+//
+// Usage: permrt [-b BOUND] [-m enum|prune] < input
+//
+// X and all of the permutations that are considered must be less than
+// BOUND, which defaults to 1000000 like the table, and can be up to 10^12.
+// The input has the same format as for permute.c.
+//
+// The enum method (the default) tries every permutation of every class
+// against the divisors.  The prune method first decides divisors without
+// looking at the permutations where that is cheaper: the residues mod d
+// that the digits of a class can reach are worked out by placing one digit
+// at a time, so a class is thrown out as soon as one divisor can't reach
+// residue 0.  The remaining divisors are tested on the permutations with a
+// multiply instead of a division (see divisor.h).  See classPruned().
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "divisor.h"
+#include "signature.h"
+
+#define MAX_DIGITS	12
+#define DP_MAX_CELLS	(1 << 22)	// Largest residue table for prune
+#define PERM_COST	8		// Residue updates one permutation costs
+
+static int  classDivides(const int *signature, int len,
+			    const uint64_t *divisors, int n, uint64_t bound);
+static int  classPruned(const int *signature, int len, const Divisor *divs,
+			    int n, uint64_t bound, unsigned char *table);
+static int  reachesZero(const int *count, uint64_t d, unsigned char *table);
+
+int main(int argc, char *argv[])
+{
+    uint64_t       bound    = 1000000;
+    uint64_t      *divisors = NULL;
+    Divisor       *divs     = NULL;
+    unsigned char *table    = NULL;
+    int            digits[MAX_DIGITS];
+    int            prune    = 0;
+    int            N        = 0;
+    int            len      = 0;
+    int            opt      = 0;
+    int            i;
+
+    while ((opt = getopt(argc, argv, "b:m:")) != -1) {
+	switch (opt) {
+	    case 'b':
+		bound = strtoull(optarg, NULL, 0);
+		break;
+	    case 'm':
+		if (strcmp(optarg, "prune") == 0)
+		    prune = 1;
+		else if (strcmp(optarg, "enum") != 0)
+		    goto usage;
+		break;
+	    default:
+		goto usage;
+	}
+    }
+    if (bound < 2 || bound > 1000000000000ULL)
+	goto usage;
+
+    if (scanf("%d", &N) != 1 || N < 0)
+	goto usage;
+    divisors = malloc((N + 1) * sizeof(uint64_t));
+    for (i=0;i<N;i++) {
+	if (scanf("%llu", (unsigned long long *) &divisors[i]) != 1 ||
+		divisors[i] == 0)
+	    goto usage;
+    }
+    if (prune) {
+	divs  = malloc((N + 1) * sizeof(Divisor));
+	table = malloc(DP_MAX_CELLS);
+	for (i=0;i<N;i++)
+	    initDivisor(&divs[i], divisors[i]);
+    }
+
+    for (len=1;len<=MAX_DIGITS;len++) {
+	// The first signature of this length is 100...0.
+	digits[0] = 1;
+	for (i=1;i<len;i++)
+	    digits[i] = 0;
+	do {
+	    uint64_t x = 0;
+
+	    for (i=0;i<len;i++)
+		x = x * 10 + digits[i];
+	    if (x >= bound) {
+		printf("Not found\n");
+		return 0;
+	    }
+	    if (prune ? classPruned(digits, len, divs, N, bound, table) :
+			classDivides(digits, len, divisors, N, bound)) {
+		printf("%llu\n", (unsigned long long) x);
+		return 0;
+	    }
+	} while (nextSignature(digits, len));
+    }
+    printf("Not found\n");
+    return 0;
+
+usage:
+    printf("Usage: permrt [-b BOUND] [-m enum|prune] < input\n");
+    exit(1);
+}
+
+// Returns nonzero if each divisor divides some permutation of the signature
+// that is less than bound.  The divisors still waiting for a permutation
+// are kept at the front of left[], so each permutation is only tested
+// against those.  The value of each permutation is built from prefix[],
+// which holds the value of the first i digits, so only the digits that
+// next_permutation changed need to be redone.
+static int classDivides(const int *signature, int len,
+			const uint64_t *divisors, int n, uint64_t bound)
+{
+    uint64_t  prefix[MAX_DIGITS+1];
+    uint64_t  stack[64];
+    uint64_t *left    = n <= 64 ? stack : malloc(n * sizeof(uint64_t));
+    int       digits[MAX_DIGITS];
+    int       numLeft = n;
+    int       from    = 0;
+    int       ret     = 0;
+    int       i;
+
+    for (i=0;i<n;i++)
+	left[i] = divisors[i];
+    for (i=0;i<len;i++)
+	digits[i] = signature[i];
+    prefix[0] = 0;
+
+    while (numLeft > 0) {
+	uint64_t value;
+
+	for (i=from;i<len;i++)
+	    prefix[i+1] = prefix[i] * 10 + digits[i];
+	value = prefix[len];
+	if (value >= bound)
+	    break;
+
+	for (i=0;i<numLeft;i++) {
+	    if (value % left[i] == 0)
+		left[i--] = left[--numLeft];
+	}
+
+	from = nextPermutation(digits, len);
+	if (from < 0)
+	    break;
+    }
+    ret = (numLeft == 0);
+    if (left != stack)
+	free(left);
+    return ret;
+}
+
+// Does the same as classDivides(), but decides what it can from the digit
+// counts alone.  Working out the residues of a divisor d costs about
+// states * d * distinct digits, where states is the number of
+// sub-multisets of the digits, while trying the permutations costs one
+// test per permutation.  So a divisor is only decided from its residues
+// if that is cheaper than walking the class, and the class is dropped as
+// soon as one divisor can't reach 0.  Classes with permutations past the
+// bound are always walked, since the residues don't know about the bound.
+static int classPruned(const int *signature, int len, const Divisor *divs,
+			int n, uint64_t bound, unsigned char *table)
+{
+    Divisor   stack[64];
+    Divisor  *left      = n <= 64 ? stack : malloc(n * sizeof(Divisor));
+    uint64_t  prefix[MAX_DIGITS+1];
+    uint64_t  perms     = 1;
+    uint64_t  states    = 1;
+    uint64_t  largest   = 0;
+    int       count[10] = {0};
+    int       digits[MAX_DIGITS];
+    int       digitSum  = 0;
+    int       distinct  = 0;
+    int       numLeft   = 0;
+    int       from      = 0;
+    int       ret       = 0;
+    int       i, j;
+
+    // perms = len! / (count[0]! * ... * count[9]!), built up one digit at
+    // a time so that it stays exact.
+    for (i=0;i<len;i++) {
+	digits[i] = signature[i];
+	count[signature[i]]++;
+	perms = perms * (i + 1) / count[signature[i]];
+	digitSum += signature[i];
+    }
+    for (i=9;i>=0;i--) {
+	for (j=0;j<count[i];j++)
+	    largest = largest * 10 + i;
+	states   *= count[i] + 1;
+	distinct += count[i] != 0;
+    }
+
+    for (i=0;i<n;i++) {
+	uint64_t cost = states * divs[i].d;
+
+	// Every permutation has the same residue mod 9 as the digit sum, so
+	// a factor of 3 or 9 in d that the digit sum doesn't have rules out
+	// the whole class for free.
+	if ((divs[i].d % 9 == 0 && digitSum % 9 != 0) ||
+		(divs[i].d % 3 == 0 && digitSum % 3 != 0))
+	    goto done;
+
+	if (largest < bound && cost <= DP_MAX_CELLS &&
+		cost * distinct < perms * PERM_COST) {
+	    if (!reachesZero(count, divs[i].d, table))
+		goto done;
+	} else {
+	    left[numLeft++] = divs[i];
+	}
+    }
+
+    prefix[0] = 0;
+    while (numLeft > 0) {
+	uint64_t value;
+
+	for (i=from;i<len;i++)
+	    prefix[i+1] = prefix[i] * 10 + digits[i];
+	value = prefix[len];
+	if (value >= bound)
+	    break;
+
+	for (i=0;i<numLeft;i++) {
+	    if (divides(&left[i], value))
+		left[i--] = left[--numLeft];
+	}
+
+	from = nextPermutation(digits, len);
+	if (from < 0)
+	    break;
+    }
+    ret = (numLeft == 0);
+done:
+    if (left != stack)
+	free(left);
+    return ret;
+}
+
+// Returns nonzero if the digits in count can be arranged, without a
+// leading zero, into a multiple of d.
+//
+// The digits are placed from the left.  A state is the multiset of digits
+// not placed yet, numbered in mixed radix with digit i worth stride[i], and
+// table[state * d + r] is set if the digits placed so far can make a
+// prefix that is r mod d.  Placing digit x takes state s with residue r to
+// s - stride[x] with residue r * 10 + x.  Since that always lowers the
+// state number, going through the states from the highest (nothing placed)
+// to 0 (everything placed) sees every state after all the ones that lead
+// to it.
+static int reachesZero(const int *count, uint64_t d, unsigned char *table)
+{
+    uint64_t stride[10];
+    int      left[10];
+    uint64_t states = 1;
+    uint64_t s, r;
+    int      x;
+
+    for (x=0;x<10;x++) {
+	stride[x] = states;
+	states   *= count[x] + 1;
+    }
+    memset(table, 0, states * d);
+    table[(states - 1) * d] = 1;
+
+    for (s=states-1;s>0;s--) {
+	unsigned char *from = table + s * d;
+	uint64_t       rest = s;
+
+	for (x=0;x<10;x++) {
+	    left[x] = rest % (count[x] + 1);
+	    rest   /= count[x] + 1;
+	}
+	for (x=0;x<10;x++) {
+	    unsigned char *to      = table + (s - stride[x]) * d;
+	    uint64_t       shifted = 0;	// r * 10 % d
+
+	    // The first digit can't be 0.
+	    if (left[x] == 0 || (x == 0 && s == states - 1))
+		continue;
+	    for (r=0;r<d;r++) {
+		if (from[r]) {
+		    uint64_t next = shifted + x;
+		    while (next >= d)
+			next -= d;
+		    to[next] = 1;
+		}
+		shifted += 10;
+		while (shifted >= d)
+		    shifted -= d;
+	    }
+	}
+    }
+    return table[0];
+}
@@ -21,8 +21,71 @@
 //
 // 102246
 //
+// If compiled with -DUSE_BINARY_TABLE, the table is instead read at run
+// time from the binary file written by "gentable -b" (table.bin, or the file
+// named by the first argument).  It is mapped read-only, so any number of
+// solvers can share one copy of it.
+//
 #include <stdio.h>
 
+#ifdef USE_BINARY_TABLE
+#include <stdlib.h>
+#include "ptable.h"
+
+int main(int argc, char *argv[])
+{
+    const char *path  = (argc > 1) ? argv[1] : "table.bin";
+    uint64_t   *perms = NULL;
+    uint64_t    curClass;
+    PTable      table;
+    int         size  = 0;
+    int         N, n[100];
+    int         i, j, k;
+
+    if (ptableOpen(&table, path) < 0) {
+	fprintf(stderr, "%s: not a permutation table\n", path);
+	return 1;
+    }
+    scanf("%d", &N);
+    for(i=0;i<N;i++) scanf("%d", &n[i]);
+    for (curClass = 0; curClass < table.numClasses; curClass++) {
+	int found = 0;
+	int count = ptableClass(&table, curClass, perms, size);
+
+	// Grow the buffer for a bigger class than any so far.
+	if (count > size) {
+	    uint64_t *grown = realloc(perms, count * sizeof(uint64_t));
+
+	    if (grown == NULL) {
+		fprintf(stderr, "Not enough memory.\n");
+		exit(1);
+	    }
+	    perms = grown;
+	    size  = count;
+	    ptableClass(&table, curClass, perms, size);
+	}
+
+	// For each divisor, check each permutation to see if it divides.
+	for(j=0;j<N;j++) {
+	    int divisor = n[j];
+	    for (k=0; k<count; k++) {
+		if (perms[k] % divisor == 0) {
+		    found++;
+		    break;
+		}
+	    }
+	    if (found <= j)
+		break;
+	}
+	if (found < N)
+	    continue;
+	printf("%llu\n", (unsigned long long) perms[0]);
+	return 0;
+    }
+    printf("Not found\n");
+    return 0;
+}
+#else
 // table.h is the file generated by gentable.c
 // It should contain MAX numbers, with the last number being -MAX.
 int permutations[] = {
@@ -67,3 +130,4 @@ int main()
     printf("Not found\n");
     return 0;
 }
+#endif
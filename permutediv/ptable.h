@@ -0,0 +1,211 @@
+// Binary permutation table, written by gentable.c and read by permute.c.
+//
+// This holds the same classes as the text table: each class is the list of
+// numbers below the bound that are permutations of each other, starting
+// with its lowest number, and the classes are in increasing order of that
+// number.  The file is laid out so that it can be mmap()ed read-only and
+// used in place by any number of processes:
+//
+//   char magic[8]                       "PTABLE01"
+//   uint64_t bound                      Every number is below this
+//   uint64_t numClasses
+//   uint64_t dataSize
+//   uint64_t offsets[numClasses + 1]    Byte offset of each class in data
+//   unsigned char data[dataSize]
+//
+// Each class in data is its first number, followed by the differences
+// between consecutive numbers of the class, each as a LEB128 varint (7 bits
+// per byte, low bits first, high bit set on every byte except the last).
+// The differences within a class are small, so most numbers take 1 or 2
+// bytes.  The last offset is dataSize, so a class ends where the next one
+// begins.  All integers are stored little endian, and are always read and
+// written a byte at a time with ptableGet64() and ptablePut64(), so a table
+// can be used on a machine of either byte order.
+#ifndef PTABLE_H
+#define PTABLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PTABLE_MAGIC	"PTABLE01"
+#define PTABLE_HEADER	32		// Bytes before the offsets
+
+typedef struct PTable {
+    const void          *map;
+    size_t               mapSize;
+    uint64_t             bound;
+    uint64_t             numClasses;
+    const unsigned char *offsets;	// Use ptableOffset() to read
+    const unsigned char *data;
+} PTable;
+
+static inline uint64_t ptableGet64(const unsigned char *src)
+{
+    uint64_t val = 0;
+    int      i;
+
+    for (i=7;i>=0;i--)
+	val = (val << 8) | src[i];
+    return val;
+}
+
+static inline void ptablePut64(unsigned char *dst, uint64_t val)
+{
+    int i;
+
+    for (i=0;i<8;i++)
+	dst[i] = (unsigned char) (val >> (8 * i));
+}
+
+// Returns the byte offset in data where class k starts.
+static inline uint64_t ptableOffset(const PTable *t, uint64_t k)
+{
+    return ptableGet64(t->offsets + 8 * k);
+}
+
+// Appends val as a varint at dst, and returns the number of bytes used
+// (at most 10).
+static inline int ptablePutVarint(unsigned char *dst, uint64_t val)
+{
+    int len = 0;
+
+    while (val >= 0x80) {
+	dst[len++] = (unsigned char) (val | 0x80);
+	val >>= 7;
+    }
+    dst[len++] = (unsigned char) val;
+    return len;
+}
+
+// Writes a whole table.  Returns 0 on success or -1 on a write error.
+static inline int ptableWrite(FILE *fp, uint64_t bound, uint64_t numClasses,
+				const uint64_t *offsets,
+				const unsigned char *data)
+{
+    unsigned char header[PTABLE_HEADER];
+    unsigned char buf[8 * 1024];
+    uint64_t      dataSize = offsets[numClasses];
+    uint64_t      k;
+    size_t        len = 0;
+
+    memcpy(header, PTABLE_MAGIC, 8);
+    ptablePut64(header + 8, bound);
+    ptablePut64(header + 16, numClasses);
+    ptablePut64(header + 24, dataSize);
+    if (fwrite(header, 1, sizeof(header), fp) != sizeof(header))
+	return -1;
+    for (k=0;k<=numClasses;k++) {
+	ptablePut64(buf + len, offsets[k]);
+	len += 8;
+	if (len == sizeof(buf) || k == numClasses) {
+	    if (fwrite(buf, 1, len, fp) != len)
+		return -1;
+	    len = 0;
+	}
+    }
+    if (fwrite(data, 1, dataSize, fp) != dataSize)
+	return -1;
+    return 0;
+}
+
+// Maps the table at path read-only.  Returns 0 on success, or -1 if the
+// file can't be mapped or isn't a complete table.  Every offset and every
+// varint is checked here, so ptableClass() never has to: a varint may not
+// run past 10 bytes, since that would shift past 64 bits.
+static inline int ptableOpen(PTable *t, const char *path)
+{
+    const unsigned char *header;
+    struct stat          st;
+    uint64_t             dataSize;
+    uint64_t             need;
+    uint64_t             k;
+    int                  run = 0;	// Continuation bytes in a row
+    int                  fd  = open(path, O_RDONLY);
+
+    if (fd < 0)
+	return -1;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < PTABLE_HEADER) {
+	close(fd);
+	return -1;
+    }
+    t->mapSize = st.st_size;
+    t->map     = mmap(NULL, t->mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (t->map == MAP_FAILED)
+	return -1;
+
+    header        = t->map;
+    t->bound      = ptableGet64(header + 8);
+    t->numClasses = ptableGet64(header + 16);
+    dataSize      = ptableGet64(header + 24);
+    need          = PTABLE_HEADER + (t->numClasses + 1) * 8;
+    if (memcmp(header, PTABLE_MAGIC, 8) != 0 ||
+	    t->numClasses >= t->mapSize / 8 ||
+	    need > t->mapSize || t->mapSize - need != dataSize) {
+	munmap((void *) t->map, t->mapSize);
+	return -1;
+    }
+    t->offsets = header + PTABLE_HEADER;
+    t->data    = t->offsets + (t->numClasses + 1) * 8;
+
+    // Make sure no class can point outside of data.
+    for (k=0;k<t->numClasses;k++) {
+	if (ptableOffset(t, k) > ptableOffset(t, k + 1))
+	    break;
+    }
+    if (k < t->numClasses || ptableOffset(t, k) != dataSize) {
+	munmap((void *) t->map, t->mapSize);
+	return -1;
+    }
+
+    for (k=0;k<dataSize;k++) {
+	run = (t->data[k] & 0x80) ? run + 1 : 0;
+	if (run >= 10)
+	    break;
+    }
+    if (k < dataSize) {
+	munmap((void *) t->map, t->mapSize);
+	return -1;
+    }
+    return 0;
+}
+
+static inline void ptableClose(PTable *t)
+{
+    munmap((void *) t->map, t->mapSize);
+}
+
+// Decodes class k into nums, which must have room for max numbers, and
+// returns how many numbers the class has (only the first max are stored).
+static inline int ptableClass(const PTable *t, uint64_t k, uint64_t *nums,
+				int max)
+{
+    const unsigned char *p     = t->data + ptableOffset(t, k);
+    const unsigned char *end   = t->data + ptableOffset(t, k + 1);
+    uint64_t             value = 0;
+    int                  count = 0;
+
+    while (p < end) {
+	uint64_t delta = 0;
+	int      shift = 0;
+
+	while (p < end && (*p & 0x80)) {
+	    delta |= (uint64_t) (*p++ & 0x7f) << shift;
+	    shift += 7;
+	}
+	if (p < end)
+	    delta |= (uint64_t) *p++ << shift;
+	value += delta;
+	if (count < max)
+	    nums[count] = value;
+	count++;
+    }
+    return count;
+}
+
+#endif
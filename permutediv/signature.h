@@ -0,0 +1,65 @@
+// Walking the permutation classes in order, shared by permrt.c and
+// gentable.c.
+//
+// Numbers with the same digits form a class, and the lowest number of a
+// class (its signature) is its smallest nonzero digit followed by the rest
+// of its digits in increasing order.  nextSignature() steps through the
+// signatures of one length in increasing order, and nextPermutation()
+// steps through the numbers of one class in increasing order, starting
+// from its signature.
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+// Moves digits to the next signature of the same length, or returns 0 if
+// this was the last one.  Digits after the first must be nondecreasing and
+// either 0 or at least the first digit.
+static inline int nextSignature(int *digits, int len)
+{
+    int first = digits[0];
+    int i, j;
+
+    for (i=len-1;i>0;i--) {
+	if (digits[i] < 9) {
+	    int d = (digits[i] == 0) ? first : digits[i] + 1;
+	    for (j=i;j<len;j++)
+		digits[j] = d;
+	    return 1;
+	}
+    }
+    if (first == 9)
+	return 0;
+    digits[0] = first + 1;
+    for (i=1;i<len;i++)
+	digits[i] = 0;
+    return 1;
+}
+
+// Rearranges digits into the next permutation in increasing order, like
+// std::next_permutation.  Returns the first position that changed, or -1
+// if this was the last permutation.
+static inline int nextPermutation(int *digits, int len)
+{
+    int i = len - 2;
+    int j = len - 1;
+    int tmp;
+
+    while (i >= 0 && digits[i] >= digits[i+1])
+	i--;
+    if (i < 0)
+	return -1;
+    while (digits[j] <= digits[i])
+	j--;
+    tmp = digits[i];
+    digits[i] = digits[j];
+    digits[j] = tmp;
+
+    // Reverse the tail, which was in decreasing order.
+    for (j=i+1, tmp=len-1; j<tmp; j++, tmp--) {
+	int t = digits[j];
+	digits[j] = digits[tmp];
+	digits[tmp] = t;
+    }
+    return i;
+}
+
+#endif
@@ -1,48 +1,99 @@
 // This program counts the number of primes between n and m which do not
 // contain the digit "1".  The input consists of the number of test cases
 // following by two numbers (n, m) per test case.
+//
+// The primes come from the segmented sieve in sieve.h, and counts[] is
+// filled in as each segment is finished.
+//
+// Usage: c1 [-j THREADS] < input
+//
+// With more than one thread, the threads take segments from a shared
+// counter, sieve them with their own Sieve and fill in counts[] for each
+// segment as if it started from 0, remembering each segment's total.  A
+// prefix sum of the totals then gives each segment's real starting count,
+// and a second parallel pass adds it in.  Build with -pthread.
 #include <stdio.h>
-#include <stdbool.h>
 #include <stdlib.h>
-#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "sieve.h"
+#include "digitmask.h"
+#include "fastio.h"
 
-#define	BASE	10
+#define	MAX_THREADS	256
+#define	SEGMENT_NUMS	(2 * (uint64_t) SIEVE_SEGMENT_BITS)
 
-static bool *generatePrime(int maxNum);
-static bool isDigitOnePresent(int i);
+typedef struct Shared {
+    int           *counts;
+    int           *segTotals;	// Count of each segment on its own
+    int            maxNum;
+    int            numSegments;
+    atomic_int     nextSegment;
+    int            addOffsets;	// 0 for the first pass, 1 for the second
+} Shared;
 
-int main(void)
+static int   countSegment(const Sieve *sieve, int *counts, int count);
+static void  countParallel(int *counts, int maxNum, int numThreads);
+static void *countThread(void *arg);
+
+int main(int argc, char *argv[])
 {
-    int   numTests  = 0;
-    int  *testCases = NULL;
-    int   i         = 0;
-    int   j         = 0;
-    int   maxNum    = 0;
-    int  *counts    = NULL;
-    int   count     = 0;
-    bool *isPrime   = NULL;
-
-    scanf("%d", &numTests);
+    int   numTests   = 0;
+    int  *testCases  = NULL;
+    int   i          = 0;
+    int   j          = 0;
+    int   maxNum     = 0;
+    int  *counts     = NULL;
+    int   count      = 0;
+    int   numThreads = 1;
+    int   opt        = 0;
+    Sieve     sieve;
+    DigitMask mask;
+    FastIn    in;
+    FastOut   out;
+
+    while ((opt = getopt(argc, argv, "j:")) != -1) {
+	if (opt != 'j')
+	    goto usage;
+	numThreads = atoi(optarg);
+    }
+    if (numThreads < 1 || numThreads > MAX_THREADS)
+	goto usage;
+
+    fastInOpen(&in);
+    fastReadInt(&in, &numTests);
     testCases = malloc(2*numTests*sizeof(int));
 
     for (i=j=0;i<numTests;i++,j+=2) {
-	scanf("%d %d", &testCases[j], &testCases[j+1]);
+	fastReadInt(&in, &testCases[j]);
+	fastReadInt(&in, &testCases[j+1]);
 	if (testCases[j+1] > maxNum)
 	    maxNum = testCases[j+1];
     }
     maxNum++;
 
-    isPrime = generatePrime(maxNum);
-
-    counts    = calloc(maxNum, sizeof(*counts));
-    count     = 1;
-    counts[2] = count;
-    for (i=3;i<maxNum;i++) {
-	if ((i&1) && isPrime[i] && !isDigitOnePresent(i))
-	    count++;
-	counts[i] = count;
+    counts = calloc(maxNum + 1, sizeof(*counts));
+    if (counts == NULL) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+    if (numThreads > 1) {
+	countParallel(counts, maxNum, numThreads);
+    } else {
+	if (sieveInit(&sieve, maxNum) < 0) {
+	    fprintf(stderr, "Not enough memory.\n");
+	    exit(1);
+	}
+	digitMaskInit(&mask);
+	while (sieveNext(&sieve)) {
+	    digitMaskApply(&mask, &sieve);
+	    count = countSegment(&sieve, counts, count);
+	}
+	sieveFree(&sieve);
     }
 
+    fastOutInit(&out);
     for (i=0;i<numTests;i++) {
 	int n     = testCases[i+i];
 	int m     = testCases[i+i+1];
@@ -51,39 +102,110 @@ int main(void)
 	    n--;
 	count = counts[m] - counts[n];
 	if (count == 0)
-	    puts("-1");
+	    fastWriteInt(&out, -1);
 	else
-	    printf("%d\n", count);
+	    fastWriteInt(&out, count);
     }
+    fastOutFlush(&out);
+    fastInClose(&in);
     return 0;
+
+usage:
+    printf("Usage: c1 [-j THREADS] < input\n");
+    exit(1);
+}
+
+// Fills in counts[] for the numbers of the segment that was just sieved and
+// masked, starting from count, and returns the count at the end of the
+// segment.
+static int countSegment(const Sieve *sieve, int *counts, int count)
+{
+    int j;
+
+    for (j=0;j<(int) sieve->numBits;j++) {
+	int num = sieve->lo + 2*j;
+
+	if (sieveTest(sieve, j))
+	    count++;
+	counts[num] = count;
+	// 2 is the only even prime.
+	if (num == 1)
+	    count++;
+	counts[num+1] = count;
+    }
+    return count;
 }
 
-static bool isDigitOnePresent(int i)
+static void countParallel(int *counts, int maxNum, int numThreads)
 {
-    while(i !=0) {
-	int temp = i % BASE;
-	if( temp == 1)
-	    return true;
-	i /= BASE;
+    pthread_t threads[MAX_THREADS];
+    Shared    sh;
+    int       total = 0;
+    int       pass, s, t;
+
+    sh.counts      = counts;
+    sh.maxNum      = maxNum;
+    sh.numSegments = (maxNum / 2 + SIEVE_SEGMENT_BITS - 1) /
+			SIEVE_SEGMENT_BITS;
+    sh.segTotals   = malloc((sh.numSegments + 1) * sizeof(int));
+
+    for (pass=0;pass<2;pass++) {
+	sh.addOffsets = pass;
+	atomic_init(&sh.nextSegment, 0);
+	// The segments are shared out through nextSegment, so if a thread
+	// can't be started, the ones that did start just do more of them.
+	for (t=1;t<numThreads;t++) {
+	    if (pthread_create(&threads[t], NULL, countThread, &sh) != 0)
+		break;
+	}
+	numThreads = t;
+	countThread(&sh);
+	for (t=1;t<numThreads;t++)
+	    pthread_join(threads[t], NULL);
+
+	// Turn the totals into the count before each segment.
+	if (pass == 0) {
+	    for (s=0;s<sh.numSegments;s++) {
+		int segTotal = sh.segTotals[s];
+		sh.segTotals[s] = total;
+		total += segTotal;
+	    }
+	}
     }
-    return false;
+    free(sh.segTotals);
 }
 
-static bool *generatePrime(int maxNum)
+static void *countThread(void *arg)
 {
-    int   root    = (int) sqrt(maxNum) + 1;
-    bool *isPrime = calloc(maxNum, sizeof(bool));
-    int   i       = 0;
-
-    for (i = 3; i < root; i+=2) {
-	if (!isPrime[i]) {
-	    int increment = i+i;
-	    int j;
-	    for (j = i * i ; j < maxNum; j += increment)
-		isPrime[j] = true;
+    Shared   *sh = arg;
+    Sieve     sieve;
+    DigitMask mask;
+    int       s;
+
+    if (!sh->addOffsets && sieveInit(&sieve, sh->maxNum) < 0) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+    digitMaskInit(&mask);
+    while ((s = atomic_fetch_add(&sh->nextSegment, 1)) < sh->numSegments) {
+	if (sh->addOffsets) {
+	    // The segment's numbers, lo .. lo + SEGMENT_NUMS - 1.
+	    uint64_t first = s * SEGMENT_NUMS + 1;
+	    uint64_t last  = first + SEGMENT_NUMS;
+	    uint64_t num;
+
+	    if (last > (uint64_t) sh->maxNum + 1)
+		last = sh->maxNum + 1;
+	    for (num=first;num<last;num++)
+		sh->counts[num] += sh->segTotals[s];
+	} else {
+	    sieveSeek(&sieve, s * (uint64_t) SIEVE_SEGMENT_BITS);
+	    sieveNext(&sieve);
+	    digitMaskApply(&mask, &sieve);
+	    sh->segTotals[s] = countSegment(&sieve, sh->counts, 0);
 	}
     }
-    for (i = 3; i < maxNum; i+=2)
-	isPrime[i] = !isPrime[i];
-    return isPrime;
+    if (!sh->addOffsets)
+	sieveFree(&sieve);
+    return NULL;
 }
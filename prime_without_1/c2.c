@@ -1,15 +1,16 @@
 // This program counts the number of primes between n and m which do not
 // contain the digit "1".  The input consists of the number of test cases
 // following by two numbers (n, m) per test case.
+//
+// The primes come from the segmented sieve in sieve.h, and are added to
+// the tree as each segment is finished.  digitmask.h clears the ones with
+// a 1 in them first, so only the bits left set are visited.
 #include <stdio.h>
-#include <stdbool.h>
 #include <stdlib.h>
-#include <math.h>
+#include "sieve.h"
+#include "digitmask.h"
+#include "fastio.h"
 
-#define	BASE	10
-
-static bool *generatePrime(int maxNum);
-static bool isDigitOnePresent(int i);
 static void updateTree(int *tree, int index, int maxNum);
 static int readTree(int *tree, int index);
 
@@ -21,27 +22,44 @@ int main(void)
     int   j         = 0;
     int   maxNum    = 0;
     int  *tree      = NULL;
-    bool *isPrime   = NULL;
+    Sieve     sieve;
+    DigitMask mask;
+    FastIn    in;
+    FastOut   out;
 
-    scanf("%d", &numTests);
+    fastInOpen(&in);
+    fastReadInt(&in, &numTests);
     testCases = malloc(2*numTests*sizeof(int));
 
     for (i=j=0;i<numTests;i++,j+=2) {
-	scanf("%d %d", &testCases[j], &testCases[j+1]);
+	fastReadInt(&in, &testCases[j]);
+	fastReadInt(&in, &testCases[j+1]);
 	if (testCases[j+1] > maxNum)
 	    maxNum = testCases[j+1];
     }
 
-    isPrime = generatePrime(maxNum+1);
-
     tree = calloc(maxNum+1, sizeof(*tree));
-    for (i=3;i<=maxNum;i+=2) {
-	if (isPrime[i] && !isDigitOnePresent(i))
-	    updateTree(tree, i, maxNum);
+    if (tree == NULL || sieveInit(&sieve, maxNum+1) < 0) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+    digitMaskInit(&mask);
+    while (sieveNext(&sieve)) {
+	digitMaskApply(&mask, &sieve);
+	for (j=0;j<(int) (sieve.numBits + 63) / 64;j++) {
+	    uint64_t bits = sieve.bits[j];
+
+	    for (;bits!=0;bits&=bits-1) {
+		int num = sieve.lo + 128*j + 2*__builtin_ctzll(bits);
+		updateTree(tree, num, maxNum);
+	    }
+	}
     }
+    sieveFree(&sieve);
     // Also add 2
     updateTree(tree, 2, maxNum);
 
+    fastOutInit(&out);
     for (i=0;i<numTests;i++) {
 	int n     = testCases[i+i];
 	int m     = testCases[i+i+1];
@@ -51,10 +69,12 @@ int main(void)
 	    n--;
 	count = readTree(tree, m) - readTree(tree, n);
 	if (count == 0)
-	    puts("-1");
+	    fastWriteInt(&out, -1);
 	else
-	    printf("%d\n", count);
+	    fastWriteInt(&out, count);
     }
+    fastOutFlush(&out);
+    fastInClose(&in);
     return 0;
 }
 
@@ -75,33 +95,3 @@ static int readTree(int *tree, int index)
     }
     return sum;
 }
-
-static bool isDigitOnePresent(int i)
-{
-    while(i !=0) {
-	int temp = i % BASE;
-	if( temp == 1)
-	    return true;
-	i /= BASE;
-    }
-    return false;
-}
-
-static bool *generatePrime(int maxNum)
-{
-    int   root    = (int) sqrt(maxNum);
-    bool *isPrime = calloc(maxNum, sizeof(bool));
-    int   i       = 0;
-
-    for (i = 3; i < root; i+=2) {
-	if (!isPrime[i]) {
-	    int increment = i+i;
-	    int j;
-	    for (j = i * i ; j < maxNum; j += increment)
-		isPrime[j] = true;
-	}
-    }
-    for (i = 3; i < maxNum; i+=2)
-	isPrime[i] = !isPrime[i];
-    return isPrime;
-}
@@ -0,0 +1,125 @@
+// This program counts the number of primes between n and m which do not
+// contain the digit "1".  The input consists of the number of test cases
+// following by two numbers (n, m) per test case.
+//
+// Unlike c1.c and c2.c, this keeps nothing the size of the largest m.
+// Each query needs the count of primes up to two points, n - 1 and m, so
+// all of the points are sorted and the segmented sieve from sieve.h sweeps
+// past them once.  As the sweep passes a point, the running count is
+// written into that point's slot, and the queries are answered from the
+// slots in input order.  Memory is a few words per query plus the sieve.
+// Since nothing grows with m, n and m are read as 64 bits and can go well
+// past the range of an int.
+#include <stdio.h>
+#include <stdlib.h>
+#include "sieve.h"
+#include "digitmask.h"
+#include "fastio.h"
+
+typedef struct Point {
+    int64_t value;
+    int     slot;		// Index into counts[]
+} Point;
+
+static int comparePoints(const void *a, const void *b);
+
+int main(void)
+{
+    int      numTests  = 0;
+    int      numPoints = 0;
+    int64_t *testCases = NULL;
+    int64_t *counts    = NULL;	// Primes up to each point
+    Point   *points    = NULL;
+    int      i         = 0;
+    int      j         = 0;
+    int      p         = 0;
+    int64_t  maxNum    = 0;
+    int64_t  total     = 0;	// Odd primes below the current segment
+    Sieve     sieve;
+    DigitMask mask;
+    FastIn    in;
+    FastOut   out;
+
+    fastInOpen(&in);
+    fastReadInt(&in, &numTests);
+    numPoints = 2*numTests;
+    testCases = malloc((numPoints+1)*sizeof(int64_t));
+    counts    = malloc((numPoints+1)*sizeof(int64_t));
+    points    = malloc((numPoints+1)*sizeof(Point));
+    if (testCases == NULL || counts == NULL || points == NULL) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+
+    for (i=j=0;i<numTests;i++,j+=2) {
+	fastReadInt64(&in, &testCases[j]);
+	fastReadInt64(&in, &testCases[j+1]);
+	if (testCases[j+1] > maxNum)
+	    maxNum = testCases[j+1];
+	points[j].value   = testCases[j] > 0 ? testCases[j] - 1 : 0;
+	points[j].slot    = j;
+	points[j+1].value = testCases[j+1];
+	points[j+1].slot  = j+1;
+    }
+    qsort(points, numPoints, sizeof(Point), comparePoints);
+
+    if (sieveInit(&sieve, (uint64_t) maxNum + 1) < 0) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+    digitMaskInit(&mask);
+    while (sieveNext(&sieve)) {
+	int64_t last = sieve.lo + 2*(sieve.numBits - 1);	// Last odd number
+	int64_t word = 0;
+	int64_t run  = total;	// Primes before bit word * 64
+
+	digitMaskApply(&mask, &sieve);
+
+	// Every point up to last + 1 belongs to this segment.  For point x,
+	// the bits of the odd numbers up to x are the first b bits.
+	for (;p<numPoints && points[p].value<=last+1;p++) {
+	    int64_t b = (points[p].value - (int64_t) sieve.lo + 2) / 2;
+
+	    for (;(word+1)*64<=b;word++)
+		run += __builtin_popcountll(sieve.bits[word]);
+	    counts[points[p].slot] = run;
+	    if (b % 64 != 0)
+		counts[points[p].slot] += __builtin_popcountll(
+			    sieve.bits[word] & (((uint64_t) 1 << (b % 64)) - 1));
+	}
+	for (j=0;j<(int) (sieve.numBits + 63) / 64;j++)
+	    total += __builtin_popcountll(sieve.bits[j]);
+    }
+    sieveFree(&sieve);
+    for (;p<numPoints;p++)
+	counts[points[p].slot] = total;
+
+    // 2 is the only even prime.
+    for (i=0;i<numPoints;i++) {
+	int64_t x = i % 2 ? testCases[i] : testCases[i] - 1;
+
+	if (x >= 2)
+	    counts[i]++;
+    }
+
+    fastOutInit(&out);
+    for (i=0;i<numTests;i++) {
+	int64_t count = counts[i+i+1] - counts[i+i];
+
+	if (count == 0)
+	    fastWriteInt(&out, -1);
+	else
+	    fastWriteInt(&out, count);
+    }
+    fastOutFlush(&out);
+    fastInClose(&in);
+    return 0;
+}
+
+static int comparePoints(const void *a, const void *b)
+{
+    const Point *x = a;
+    const Point *y = b;
+
+    return (x->value > y->value) - (x->value < y->value);
+}
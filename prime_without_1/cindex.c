@@ -0,0 +1,289 @@
+// This program counts the number of primes between n and m which do not
+// contain the digit "1", like c1.c, but from a prebuilt index file so that
+// nothing has to be sieved from 0 on every run.
+//
+// Usage: cindex -b [-n LIMIT] [-f FILE]
+//        cindex [-f FILE] < input
+//
+// With -b, the numbers up to LIMIT (rounded up to a whole block) are sieved
+// once and the index is written to FILE, which defaults to counts.idx.
+// Otherwise, the index is mmap()ed read-only and the input, in the same
+// format as for c1.c, is answered from it.  A query that reaches past the
+// end of the index, or that has n > m + 1, is an error.
+//
+// The index holds the count of primes without a 1 below every multiple of
+// INDEX_BLOCK, so the count up to any x is the count at the start of x's
+// block plus the primes in the block up to x.  Only that part of one block
+// is sieved for each end of a query, so the cost of a query doesn't depend
+// on how large m is.  The file is laid out as:
+//
+//   char magic[8]                       "PCINDEX1"
+//   uint64_t blockSize                  INDEX_BLOCK
+//   uint64_t numBlocks                  Numbers below numBlocks * blockSize
+//   uint32_t counts[numBlocks + 1]      Primes below block * INDEX_BLOCK
+//
+// All integers are stored little endian, and are always read and written a
+// byte at a time, so an index can be used on a machine of either byte
+// order.
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sieve.h"
+#include "digitmask.h"
+#include "fastio.h"
+
+#define INDEX_MAGIC	"PCINDEX1"
+#define INDEX_SHIFT	16
+#define INDEX_BLOCK	((uint64_t) 1 << INDEX_SHIFT)
+#define MAX_LIMIT	((uint64_t) 1 << 31)
+
+#define INDEX_HEADER	24		// Bytes before the counts
+
+typedef struct Index {
+    const void          *map;
+    size_t               mapSize;
+    uint64_t             numBlocks;
+    const unsigned char *counts;	// Use indexCount() to read
+} Index;
+
+static uint64_t indexGet(const unsigned char *src, int len);
+static void     indexPut(unsigned char *dst, uint64_t val, int len);
+static uint32_t indexCount(const Index *idx, uint64_t block);
+static int      buildIndex(const char *path, uint64_t limit);
+static int      openIndex(Index *idx, const char *path);
+static uint64_t countUpTo(const Index *idx, Sieve *sieve, DigitMask *mask,
+			    int64_t x);
+
+int main(int argc, char *argv[])
+{
+    const char *path     = "counts.idx";
+    uint64_t    limit    = 10000000;
+    int         build    = 0;
+    int         numTests = 0;
+    int         opt      = 0;
+    int         i;
+    Index       idx;
+    Sieve       sieve;
+    DigitMask   mask;
+    FastIn      in;
+    FastOut     out;
+
+    while ((opt = getopt(argc, argv, "bn:f:")) != -1) {
+	switch (opt) {
+	    case 'b': build = 1;                             break;
+	    case 'n': limit = strtoull(optarg, NULL, 0);     break;
+	    case 'f': path  = optarg;                        break;
+	    default:  goto usage;
+	}
+    }
+    if (limit < 1 || limit > MAX_LIMIT)
+	goto usage;
+
+    if (build) {
+	if (buildIndex(path, limit) < 0) {
+	    fprintf(stderr, "%s: could not write index\n", path);
+	    return 1;
+	}
+	return 0;
+    }
+
+    if (openIndex(&idx, path) < 0) {
+	fprintf(stderr, "%s: not a prime count index\n", path);
+	return 1;
+    }
+    // The base primes only have to reach sqrt of the indexed range.
+    if (sieveInit(&sieve, idx.numBlocks << INDEX_SHIFT) < 0) {
+	fprintf(stderr, "Not enough memory.\n");
+	exit(1);
+    }
+    digitMaskInit(&mask);
+
+    fastInOpen(&in);
+    fastOutInit(&out);
+    fastReadInt(&in, &numTests);
+    for (i=0;i<numTests;i++) {
+	int64_t  n   = 0;
+	int64_t  m   = 0;
+	int64_t  end = idx.numBlocks << INDEX_SHIFT;
+	uint64_t count;
+
+	fastReadInt64(&in, &n);
+	fastReadInt64(&in, &m);
+	// Both ends of the query, n - 1 and m, have to be in the index.
+	if (m >= end || (n > 0 && n - 1 >= end)) {
+	    fastOutFlush(&out);
+	    fprintf(stderr, "%lld is past the end of the index.\n",
+		    (long long) (m >= end ? m : n));
+	    exit(1);
+	}
+	if (n > m + 1) {
+	    fastOutFlush(&out);
+	    fprintf(stderr, "Bad query: %lld is more than %lld + 1.\n",
+		    (long long) n, (long long) m);
+	    exit(1);
+	}
+	count = countUpTo(&idx, &sieve, &mask, m) -
+		countUpTo(&idx, &sieve, &mask, n > 0 ? n - 1 : 0);
+	if (count == 0)
+	    fastWriteInt(&out, -1);
+	else
+	    fastWriteInt(&out, count);
+    }
+    fastOutFlush(&out);
+    fastInClose(&in);
+    sieveFree(&sieve);
+    munmap((void *) idx.map, idx.mapSize);
+    return 0;
+
+usage:
+    printf("Usage: cindex -b [-n LIMIT] [-f FILE]\n"
+	   "       cindex [-f FILE] < input\n");
+    exit(1);
+}
+
+// Sieves every block up to limit and writes the index.  A sieve segment is
+// a whole number of blocks, and blocks start on even numbers, so each
+// block is 2^15 bits of one segment.  Returns -1 on failure.
+static int buildIndex(const char *path, uint64_t limit)
+{
+    uint64_t  numBlocks = (limit + INDEX_BLOCK - 1) >> INDEX_SHIFT;
+    uint32_t *counts    = malloc((numBlocks + 1) * sizeof(uint32_t));
+    uint32_t  total     = 1;		// 2 is the only even prime
+    uint64_t  block     = 0;
+    int       words     = INDEX_BLOCK / 128;
+    unsigned char header[INDEX_HEADER];
+    unsigned char buf[8 * 1024];
+    size_t        len = 0;
+    Sieve         sieve;
+    DigitMask     mask;
+    FILE         *fp;
+    int           ret = 0;
+
+    if (counts == NULL || sieveInit(&sieve, numBlocks << INDEX_SHIFT) < 0) {
+	free(counts);
+	return -1;
+    }
+    digitMaskInit(&mask);
+    counts[0] = 0;
+    while (sieveNext(&sieve)) {
+	uint64_t w;
+
+	digitMaskApply(&mask, &sieve);
+	for (w=0;w<(sieve.numBits + 63) / 64;w++) {
+	    total += __builtin_popcountll(sieve.bits[w]);
+	    if ((w + 1) % words == 0)
+		counts[++block] = total;
+	}
+    }
+    sieveFree(&sieve);
+
+    memcpy(header, INDEX_MAGIC, 8);
+    indexPut(header + 8, INDEX_BLOCK, 8);
+    indexPut(header + 16, numBlocks, 8);
+    fp = fopen(path, "wb");
+    if (fp == NULL || fwrite(header, 1, sizeof(header), fp) != sizeof(header))
+	ret = -1;
+    for (block=0;block<=numBlocks && ret==0;block++) {
+	indexPut(buf + len, counts[block], 4);
+	len += 4;
+	if (len == sizeof(buf) || block == numBlocks) {
+	    if (fwrite(buf, 1, len, fp) != len)
+		ret = -1;
+	    len = 0;
+	}
+    }
+    if (fp != NULL && fclose(fp) != 0)
+	ret = -1;
+    free(counts);
+    return ret;
+}
+
+// Maps the index at path read-only.  Returns 0 on success, or -1 if the
+// file can't be mapped or isn't a complete index.
+static int openIndex(Index *idx, const char *path)
+{
+    const unsigned char *header;
+    struct stat          st;
+    uint64_t             numBlocks;
+    int                  fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+	return -1;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < INDEX_HEADER) {
+	close(fd);
+	return -1;
+    }
+    idx->mapSize = st.st_size;
+    idx->map     = mmap(NULL, idx->mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (idx->map == MAP_FAILED)
+	return -1;
+
+    header    = idx->map;
+    numBlocks = indexGet(header + 16, 8);
+    if (memcmp(header, INDEX_MAGIC, 8) != 0 ||
+	    indexGet(header + 8, 8) != INDEX_BLOCK ||
+	    numBlocks > MAX_LIMIT >> INDEX_SHIFT ||
+	    idx->mapSize != INDEX_HEADER + (numBlocks + 1) * 4) {
+	munmap((void *) idx->map, idx->mapSize);
+	return -1;
+    }
+    idx->numBlocks = numBlocks;
+    idx->counts    = header + INDEX_HEADER;
+    return 0;
+}
+
+// Reads a len byte little endian integer.
+static uint64_t indexGet(const unsigned char *src, int len)
+{
+    uint64_t val = 0;
+
+    while (len-- > 0)
+	val = (val << 8) | src[len];
+    return val;
+}
+
+// Writes val as a len byte little endian integer.
+static void indexPut(unsigned char *dst, uint64_t val, int len)
+{
+    int i;
+
+    for (i=0;i<len;i++)
+	dst[i] = (unsigned char) (val >> (8 * i));
+}
+
+// Returns the count of primes below block * INDEX_BLOCK.
+static uint32_t indexCount(const Index *idx, uint64_t block)
+{
+    return indexGet(idx->counts + 4 * block, 4);
+}
+
+// Returns the number of primes without a 1 up to x.  The odd numbers from
+// the start of x's block up to x are sieved as a single segment, with
+// sieveSeekRange() to the block, stopping after x.
+static uint64_t countUpTo(const Index *idx, Sieve *sieve, DigitMask *mask,
+			    int64_t x)
+{
+    uint64_t block = (uint64_t) x >> INDEX_SHIFT;
+    uint64_t count;
+    uint64_t w;
+
+    if (x < 2)
+	return 0;
+    count = indexCount(idx, block);
+    if (block == 0)
+	count++;		// 2
+
+    sieveSeekRange(sieve, (block << INDEX_SHIFT) / 2, (x + 1) / 2);
+    if (sieveNext(sieve)) {
+	digitMaskApply(mask, sieve);
+	for (w=0;w<(sieve->numBits + 63) / 64;w++)
+	    count += __builtin_popcountll(sieve->bits[w]);
+    }
+    return count;
+}
@@ -0,0 +1,100 @@
+// Drops the numbers that contain the digit 1 from a sieve segment, shared
+// by c1.c and c2.c.
+//
+// Rather than taking every prime apart digit by digit, the segment is
+// masked 64 numbers (one word) at a time.  A number with no 1 in it has no
+// 1 in its last three digits and none in the rest (its "thousand").  The
+// odd numbers below 1000 without a 1 are worked out once, as a 500 bit
+// pattern, and a thousand either has a 1 in it, which clears its whole run
+// of the segment, or it doesn't, which lets the pattern through.  One word
+// covers 128 numbers, so it takes in at most two thousands.
+//
+// Usage, after each sieveNext():
+//
+//     DigitMask m;
+//
+//     digitMaskInit(&m);
+//     ...
+//     digitMaskApply(&m, &s);
+//
+// Afterwards a set bit means a prime without a 1, and the bits past
+// s.numBits in the last word are clear, so the words can be scanned
+// directly.
+#ifndef DIGITMASK_H
+#define DIGITMASK_H
+
+#include <stdint.h>
+#include "sieve.h"
+
+#define DIGITMASK_ODDS	500		// Odd numbers in a thousand
+
+typedef struct DigitMask {
+    uint64_t low[DIGITMASK_ODDS / 64 + 2];	// Bit k: 2k + 1 has no 1
+    uint64_t lastThousand;
+    int      lastHasOne;
+} DigitMask;
+
+static inline int digitMaskHasOne(uint64_t n)
+{
+    for (;n!=0;n/=10) {
+	if (n % 10 == 1)
+	    return 1;
+    }
+    return 0;
+}
+
+static inline void digitMaskInit(DigitMask *m)
+{
+    int k;
+
+    memset(m, 0, sizeof(*m));
+    for (k=0;k<DIGITMASK_ODDS;k++) {
+	if (!digitMaskHasOne(2 * k + 1))
+	    m->low[k / 64] |= (uint64_t) 1 << (k % 64);
+    }
+}
+
+// Returns n bits (1 to 64) of the pattern of thousand t, starting at odd
+// number k, or 0 if t has a 1 in it.
+static inline uint64_t digitMaskBits(DigitMask *m, uint64_t t, int k, int n)
+{
+    uint64_t bits;
+    int      shift = k % 64;
+
+    if (t != m->lastThousand) {
+	m->lastThousand = t;
+	m->lastHasOne   = digitMaskHasOne(t);
+    }
+    if (m->lastHasOne)
+	return 0;
+    bits = m->low[k / 64] >> shift;
+    if (shift != 0)
+	bits |= m->low[k / 64 + 1] << (64 - shift);
+    return n == 64 ? bits : bits & (((uint64_t) 1 << n) - 1);
+}
+
+static inline void digitMaskApply(DigitMask *m, Sieve *s)
+{
+    uint64_t words = (s->numBits + 63) / 64;
+    uint64_t w;
+
+    for (w=0;w<words;w++) {
+	uint64_t num   = s->lo + 128 * w;	// Number of bit 0 of the word
+	uint64_t t     = num / 1000;
+	int      k     = (num % 1000) / 2;
+	int      first = DIGITMASK_ODDS - k;	// Bits left in thousand t
+	uint64_t mask;
+
+	if (first >= 64) {
+	    mask = digitMaskBits(m, t, k, 64);
+	} else {
+	    mask  = digitMaskBits(m, t, k, first);
+	    mask |= digitMaskBits(m, t + 1, 0, 64 - first) << first;
+	}
+	s->bits[w] &= mask;
+    }
+    if (s->numBits % 64 != 0)
+	s->bits[words - 1] &= ((uint64_t) 1 << (s->numBits % 64)) - 1;
+}
+
+#endif
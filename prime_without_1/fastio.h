@@ -0,0 +1,165 @@
+// Bulk input and output for the prime_without_1 programs.
+//
+// The inputs are thousands of pairs of numbers, and with a fast sieve,
+// scanf() and printf() per number start to show.  Instead, all of stdin is
+// read with a few large read()s, the numbers are parsed out of the buffer
+// with a plain loop over the digits, and the answers are formatted into one
+// output buffer that goes out with a single write() at the end.
+//
+// Usage:
+//
+//     FastIn  in;
+//     FastOut out;
+//
+//     fastInOpen(&in);
+//     fastOutInit(&out);
+//     while (fastReadInt(&in, &x))
+//         fastWriteInt(&out, ...);
+//     fastOutFlush(&out);
+#ifndef FASTIO_H
+#define FASTIO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FASTIO_CHUNK	(1 << 16)
+
+typedef struct FastIn {
+    char       *buf;		// All of stdin, followed by a '\0'
+    const char *pos;
+} FastIn;
+
+typedef struct FastOut {
+    char   *buf;
+    size_t  len;
+    size_t  size;
+} FastOut;
+
+static inline void fastioNoMemory(void)
+{
+    fprintf(stderr, "Not enough memory.\n");
+    exit(1);
+}
+
+// Reads all of stdin.  A read error is treated like the end of input.
+static inline void fastInOpen(FastIn *in)
+{
+    size_t  len  = 0;
+    size_t  size = FASTIO_CHUNK;
+    ssize_t got;
+
+    in->buf = malloc(size + 1);
+    if (in->buf == NULL)
+	fastioNoMemory();
+    while ((got = read(0, in->buf + len, size - len)) > 0) {
+	len += got;
+	if (len == size) {
+	    size   *= 2;
+	    in->buf = realloc(in->buf, size + 1);
+	    if (in->buf == NULL)
+		fastioNoMemory();
+	}
+    }
+    in->buf[len] = '\0';
+    in->pos      = in->buf;
+}
+
+// Parses the next integer into *val.  Anything that isn't a digit or a
+// minus sign is skipped.  Returns 0 at the end of input.  The '\0' at the
+// end stops every loop, so there are no length checks.  A number too large
+// for 64 bits is read as INT64_MAX (or INT64_MIN if negative).
+static inline int fastReadInt64(FastIn *in, int64_t *val)
+{
+    const char *p     = in->pos;
+    uint64_t    value = 0;
+    uint64_t    max   = INT64_MAX;
+    int         neg   = 0;
+
+    while (*p != '\0' && *p != '-' && (unsigned) (*p - '0') > 9)
+	p++;
+    if (*p == '\0') {
+	in->pos = p;
+	return 0;
+    }
+    if (*p == '-') {
+	neg = 1;
+	max++;
+	p++;
+    }
+    while ((unsigned) (*p - '0') <= 9) {
+	unsigned d = *p++ - '0';
+
+	value = value > (max - d) / 10 ? max : value * 10 + d;
+    }
+    in->pos = p;
+    *val    = neg ? (int64_t) -value : (int64_t) value;
+    return 1;
+}
+
+// Like fastReadInt64(), for numbers that fit in an int.
+static inline int fastReadInt(FastIn *in, int *val)
+{
+    int64_t value;
+
+    if (!fastReadInt64(in, &value))
+	return 0;
+    *val = (int) value;
+    return 1;
+}
+
+static inline void fastInClose(FastIn *in)
+{
+    free(in->buf);
+}
+
+static inline void fastOutInit(FastOut *out)
+{
+    out->len  = 0;
+    out->size = FASTIO_CHUNK;
+    out->buf  = malloc(out->size);
+    if (out->buf == NULL)
+	fastioNoMemory();
+}
+
+// Appends val and a newline.
+static inline void fastWriteInt(FastOut *out, long long val)
+{
+    char               digits[24];
+    unsigned long long v   = val < 0 ? -(unsigned long long) val :
+					   (unsigned long long) val;
+    int                len = 0;
+
+    if (out->len + sizeof(digits) > out->size) {
+	out->size *= 2;
+	out->buf   = realloc(out->buf, out->size);
+	if (out->buf == NULL)
+	    fastioNoMemory();
+    }
+    do {
+	digits[len++] = '0' + v % 10;
+	v /= 10;
+    } while (v != 0);
+    if (val < 0)
+	out->buf[out->len++] = '-';
+    while (len > 0)
+	out->buf[out->len++] = digits[--len];
+    out->buf[out->len++] = '\n';
+}
+
+// Writes out everything at once, and frees the buffer.
+static inline void fastOutFlush(FastOut *out)
+{
+    size_t  done = 0;
+    ssize_t put;
+
+    while (done < out->len &&
+	    (put = write(1, out->buf + done, out->len - done)) > 0)
+	done += put;
+    free(out->buf);
+    out->buf = NULL;
+}
+
+#endif
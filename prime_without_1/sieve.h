@@ -0,0 +1,180 @@
+// Segmented sieve of Eratosthenes, shared by c1.c and c2.c.
+//
+// Instead of one array covering every number up to the limit, this sieves
+// one window (segment) of SIEVE_SEGMENT_BITS odd numbers at a time, so the
+// window stays in the L1/L2 cache however large the limit is.  Only odd
+// numbers are stored, one bit each, so a segment of 2^18 bits is 32 KB and
+// covers 2^19 numbers.  Memory is the base primes up to sqrt(limit) plus
+// one segment, so a limit of 10^10 needs well under 1 MB.
+//
+// Usage:
+//
+//     Sieve s;
+//
+//     sieveInit(&s, limit);
+//     while (sieveNext(&s)) {
+//         for (i=0;i<s.numBits;i++)
+//             if (sieveTest(&s, i))
+//                 ... s.lo + 2*i is an odd prime ...
+//     }
+//     sieveFree(&s);
+//
+// The segments come in increasing order, so a caller can finish everything
+// it needs for one segment before the next one overwrites it.  2, the only
+// even prime, is left to the caller.  sieveSeek() jumps to any segment, so
+// several threads can each sieve their own segments with their own Sieve,
+// and sieveSeekRange() also stops early, so only part of the range is
+// sieved.
+#ifndef SIEVE_H
+#define SIEVE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIEVE_SEGMENT_BITS	(1 << 18)
+#define SIEVE_WORDS		(SIEVE_SEGMENT_BITS / 64)
+
+typedef struct Sieve {
+    uint64_t  limit;		// Numbers below this are sieved
+    uint64_t  lo;		// Bit i of the segment is the number lo + 2*i
+    uint64_t  numBits;		// Bits used in the current segment
+    uint64_t  nextIndex;	// Index (n / 2) of the next segment's start
+    uint64_t  endIndex;		// Index past the last odd number to sieve
+    uint64_t *bits;		// Bit set means prime
+    uint32_t *primes;		// Odd primes up to sqrt(limit)
+    uint64_t *multiple;		// Index of the next odd multiple of each
+    int       numPrimes;
+} Sieve;
+
+/**
+ * Sets up a sieve of the numbers below limit.  The odd primes up to
+ * sqrt(limit) are found with a small plain sieve first.  Returns 0 on
+ * success or -1 if memory could not be allocated.
+ */
+static inline int sieveInit(Sieve *s, uint64_t limit)
+{
+    uint64_t       root = 1;
+    unsigned char *composite;
+    uint64_t       i, j;
+
+    memset(s, 0, sizeof(*s));
+    s->limit    = limit;
+    s->endIndex = limit / 2;		// Index past the last odd number
+    while ((root + 1) * (root + 1) < limit)
+	root++;
+
+    composite   = calloc(root + 1, 1);
+    s->bits     = malloc(SIEVE_WORDS * sizeof(uint64_t));
+    s->primes   = malloc((root / 2 + 1) * sizeof(uint32_t));
+    s->multiple = malloc((root / 2 + 1) * sizeof(uint64_t));
+    if (composite == NULL || s->bits == NULL || s->primes == NULL ||
+	    s->multiple == NULL) {
+	free(composite);
+	return -1;
+    }
+
+    for (i=3;i<=root;i+=2) {
+	if (composite[i])
+	    continue;
+	for (j=i*i;j<=root;j+=2*i)
+	    composite[j] = 1;
+	// Odd multiples of i are i apart in index space, and the first one
+	// not crossed off by a smaller prime is i*i.
+	s->primes[s->numPrimes]     = (uint32_t) i;
+	s->multiple[s->numPrimes++] = i * i / 2;
+    }
+    free(composite);
+    return 0;
+}
+
+/**
+ * Sieves the next segment.  Returns 0 when the whole range is done.
+ */
+static inline int sieveNext(Sieve *s)
+{
+    uint64_t start = s->nextIndex;
+    uint64_t end   = s->endIndex;
+    uint64_t words;
+    int      p;
+
+    if (start >= end)
+	return 0;
+    if (end - start > SIEVE_SEGMENT_BITS)
+	end = start + SIEVE_SEGMENT_BITS;
+    s->lo        = 2 * start + 1;
+    s->numBits   = end - start;
+    s->nextIndex = end;
+
+    words = (s->numBits + 63) / 64;
+    memset(s->bits, 0xff, words * sizeof(uint64_t));
+    if (start == 0)
+	s->bits[0] &= ~(uint64_t) 1;		// 1 is not prime
+
+    for (p=0;p<s->numPrimes;p++) {
+	uint64_t step = s->primes[p];
+	uint64_t k    = s->multiple[p];
+
+	// Primes whose square is past this segment, and all larger ones,
+	// have nothing to cross off yet.
+	if (step * step / 2 >= end)
+	    break;
+	for (;k<end;k+=step) {
+	    uint64_t bit = k - start;
+	    s->bits[bit / 64] &= ~((uint64_t) 1 << (bit % 64));
+	}
+	s->multiple[p] = k;
+    }
+    return 1;
+}
+
+/**
+ * Makes the next segment start at the odd number index * 2 + 1, and stops
+ * the sieve before the odd number end * 2 + 1 (but never past the limit).
+ * Every base prime p has to move to its first odd multiple at or after the
+ * start, but not before p*p.  The odd multiples of p have indexes (p-1)/2
+ * mod p.
+ */
+static inline void sieveSeekRange(Sieve *s, uint64_t index, uint64_t end)
+{
+    int p;
+
+    s->nextIndex = index;
+    s->endIndex  = end < s->limit / 2 ? end : s->limit / 2;
+    for (p=0;p<s->numPrimes;p++) {
+	uint64_t step  = s->primes[p];
+	uint64_t first = step * step / 2;
+
+	if (index <= first)
+	    s->multiple[p] = first;
+	else
+	    s->multiple[p] = index + ((step - 1) / 2 + step - index % step) %
+				step;
+    }
+}
+
+/**
+ * Makes the next segment start at the odd number index * 2 + 1, and sieves
+ * from there up to the limit.
+ */
+static inline void sieveSeek(Sieve *s, uint64_t index)
+{
+    sieveSeekRange(s, index, s->limit / 2);
+}
+
+/**
+ * Returns nonzero if s->lo + 2*i is prime.
+ */
+static inline int sieveTest(const Sieve *s, uint64_t i)
+{
+    return (s->bits[i / 64] >> (i % 64)) & 1;
+}
+
+static inline void sieveFree(Sieve *s)
+{
+    free(s->multiple);
+    free(s->primes);
+    free(s->bits);
+}
+
+#endif
@@ -0,0 +1,404 @@
+/* Correctness, uniformity and timing checks for shuffle.c and part.c.
+ *
+ * Usage: shufbench [-b SECONDS] [-e MAXEXP] [-P PART]
+ *
+ * For small N, every mode of vshuffle.c is checked against an explicit
+ * Fisher-Yates shuffle driven by the same rng stream (the reference mode
+ * has to match it exactly), checked to be a permutation, and checked that
+ * vshufflePosition() inverts vshuffleAt().  Then a chi-square test is run
+ * over many seeds on the table of (position, element) counts, which should
+ * be flat for a uniform shuffle.
+ *
+ * The part program (PART, default ./part) is run with fixed seeds and
+ * binary output, and its output is checked to be a partition of 0..N into
+ * groups of size 1..M in the order that an explicit Fisher-Yates shuffle
+ * of the groups gives, for both of its rngs.
+ *
+ * Finally each mode is timed for N = 10^3 .. 10^MAXEXP (default 9).  Each
+ * run stops after SECONDS (default 2) and the total time is extrapolated
+ * from how far it got, using O(n) for the Feistel mode and O(n^2) for the
+ * replayed modes.  That shows where each algorithm stops being viable.
+ *
+ * Build with:
+ *
+ * cc -O2 shufbench.c vshuffle.c -lm -o shufbench
+ *
+ * The exit status is nonzero if any check failed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "ctrrng.h"
+#include "vshuffle.h"
+
+#define CHI_N		8	// Size of the shuffle used for chi-square
+#define CHI_TRIALS	40000
+
+static const char *modeNames[] = { "ref", "feistel" };
+
+// Results are added up here so the compiler can't skip computing them.
+static volatile uint64_t sink;
+
+static int      checkVShuffle(int mode, uint64_t n, uint64_t seed);
+static int      chiSquare(int mode);
+static int      checkPart(const char *part, int useCtr, uint64_t n,
+			    uint64_t m, uint64_t seed);
+static uint32_t mwc(uint32_t *w, uint32_t *z);
+static void     timeVShuffle(int mode, uint64_t n, double budget);
+static void     timePart(const char *part, uint64_t n, double budget);
+static double   now(void);
+
+int main(int argc, char *argv[])
+{
+    const char *part    = "./part";
+    double      budget  = 2.0;
+    int         maxExp  = 9;
+    int         failed  = 0;
+    int         opt     = 0;
+    int         mode    = 0;
+    uint64_t    n       = 0;
+    uint64_t    seed    = 0;
+    int         e       = 0;
+
+    while ((opt = getopt(argc, argv, "b:e:P:")) != -1) {
+	switch (opt) {
+	    case 'b': budget = atof(optarg); break;
+	    case 'e': maxExp = atoi(optarg); break;
+	    case 'P': part   = optarg;       break;
+	    default:
+		printf("Usage: shufbench [-b SECONDS] [-e MAXEXP] [-P PART]\n");
+		exit(1);
+	}
+    }
+
+    printf("Checking shuffles against Fisher-Yates...\n");
+    for (mode=VSHUFFLE_REF;mode<=VSHUFFLE_FEISTEL;mode++) {
+	for (n=1;n<=200;n++) {
+	    for (seed=0;seed<8;seed++)
+		failed |= checkVShuffle(mode, n, seed * 1000003 + n);
+	}
+	failed |= checkVShuffle(mode, 4099, 12345);
+    }
+
+    printf("Chi-square on %d elements over %d seeds...\n", CHI_N, CHI_TRIALS);
+    for (mode=VSHUFFLE_REF;mode<=VSHUFFLE_FEISTEL;mode++)
+	failed |= chiSquare(mode);
+
+    printf("Checking %s...\n", part);
+    for (seed=1;seed<=20;seed++) {
+	failed |= checkPart(part, 0, 50 * seed, 1 + seed % 7, seed);
+	failed |= checkPart(part, 1, 50 * seed, 1 + seed % 7, seed);
+    }
+    failed |= checkPart(part, 1, 20000, 13, 99);
+
+    printf("\n%-8s %12s %10s %14s %14s\n", "mode", "N", "done",
+	    "ns/element", "est. total s");
+    for (e=3;e<=maxExp;e++) {
+	n = 1;
+	for (mode=0;mode<e;mode++)
+	    n *= 10;
+	timeVShuffle(VSHUFFLE_FEISTEL, n, budget);
+	timeVShuffle(VSHUFFLE_REF, n, budget);
+	timePart(part, n, budget);
+    }
+
+    printf("\n%s\n", failed ? "FAILED" : "All checks passed");
+    return failed;
+}
+
+/**
+ * Checks one shuffle of 0..n-1.  Returns nonzero on failure.
+ */
+static int checkVShuffle(int mode, uint64_t n, uint64_t seed)
+{
+    VShuffle  vs;
+    uint64_t *array = malloc(n * sizeof(uint64_t));
+    char     *seen  = calloc(n, 1);
+    uint64_t  i     = 0;
+    int       bad   = 0;
+
+    vshuffleInit(&vs, n, seed, mode);
+
+    // The explicit Fisher-Yates shuffle: step j swaps array[j] with a
+    // random slot from [j..n-1], chosen by the j-th number of the stream.
+    for (i=0;i<n;i++)
+	array[i] = i;
+    for (i=0;i<n;i++) {
+	uint64_t r   = i + ctrBounded(vs.key, i, n - i);
+	uint64_t tmp = array[i];
+	array[i] = array[r];
+	array[r] = tmp;
+    }
+
+    for (i=0;i<n && !bad;i++) {
+	uint64_t x = vshuffleAt(&vs, i);
+
+	if (x >= n || seen[x]) {
+	    printf("  %s n=%llu seed=%llu: not a permutation at %llu\n",
+		    modeNames[mode], (unsigned long long) n,
+		    (unsigned long long) seed, (unsigned long long) i);
+	    bad = 1;
+	} else if (mode == VSHUFFLE_REF && x != array[i]) {
+	    printf("  %s n=%llu seed=%llu: position %llu is %llu, "
+		    "Fisher-Yates says %llu\n", modeNames[mode],
+		    (unsigned long long) n, (unsigned long long) seed,
+		    (unsigned long long) i, (unsigned long long) x,
+		    (unsigned long long) array[i]);
+	    bad = 1;
+	} else if (vshufflePosition(&vs, x) != i) {
+	    printf("  %s n=%llu seed=%llu: position of %llu is not %llu\n",
+		    modeNames[mode], (unsigned long long) n,
+		    (unsigned long long) seed, (unsigned long long) x,
+		    (unsigned long long) i);
+	    bad = 1;
+	}
+	seen[x < n ? x : 0] = 1;
+    }
+
+    free(array);
+    free(seen);
+    return bad;
+}
+
+/**
+ * Shuffles CHI_N elements with CHI_TRIALS different seeds and counts how
+ * often each element lands at each position.  For a uniform shuffle every
+ * count should be about CHI_TRIALS / CHI_N.  The statistic has
+ * (CHI_N-1)^2 degrees of freedom, and we fail if it is more than 5
+ * standard deviations above its mean.  Returns nonzero on failure.
+ */
+static int chiSquare(int mode)
+{
+    static uint32_t counts[CHI_N][CHI_N];
+    double          expected = (double) CHI_TRIALS / CHI_N;
+    double          chi      = 0;
+    double          df       = (CHI_N - 1) * (CHI_N - 1);
+    double          limit    = df + 5 * sqrt(2 * df);
+    VShuffle        vs;
+    int             t, i, j;
+
+    memset(counts, 0, sizeof(counts));
+    for (t=0;t<CHI_TRIALS;t++) {
+	vshuffleInit(&vs, CHI_N, t, mode);
+	for (i=0;i<CHI_N;i++)
+	    counts[i][vshuffleAt(&vs, i)]++;
+    }
+    for (i=0;i<CHI_N;i++) {
+	for (j=0;j<CHI_N;j++) {
+	    double d = counts[i][j] - expected;
+	    chi += d * d / expected;
+	}
+    }
+    printf("  %-8s chi-square %.1f (df %.0f, limit %.1f) %s\n",
+	    modeNames[mode], chi, df, limit, chi > limit ? "FAIL" : "ok");
+    return chi > limit;
+}
+
+/**
+ * Runs part with the given seed and checks its output.  This duplicates
+ * how part derives its random streams, so that the expected output can be
+ * built with an explicit array.  Returns nonzero on failure.
+ */
+static int checkPart(const char *part, int useCtr, uint64_t n, uint64_t m,
+			uint64_t seed)
+{
+    char      cmd[512];
+    FILE     *fp        = NULL;
+    uint64_t  maxGroups = n + 1;
+    uint64_t *starts    = malloc((maxGroups + 1) * sizeof(uint64_t));
+    uint64_t *shuffle   = malloc(maxGroups * sizeof(uint64_t));
+    uint32_t  partW     = (uint32_t) seed;
+    uint32_t  partZ     = ~partW;
+    uint32_t  shufW     = 0;
+    uint32_t  shufZ     = 0;
+    uint64_t  keyPart   = ctrMix(seed);
+    uint64_t  keyShuf   = ctrMix(keyPart);
+    uint64_t  numGroups = 0;
+    uint64_t  cur       = 0;
+    uint64_t  pair[2];
+    uint64_t  i         = 0;
+    int       bad       = 0;
+
+    // Partition 0..n the way countGroups() does.
+    shufW = mwc(&partW, &partZ);
+    shufZ = mwc(&partW, &partZ);
+    for (cur=0;cur<=n;numGroups++) {
+	uint64_t size;
+	if (useCtr)
+	    size = ctrBounded(keyPart, numGroups, m) + 1;
+	else
+	    size = mwc(&partW, &partZ) % m + 1;
+	starts[numGroups] = cur;
+	cur += size;
+    }
+    starts[numGroups] = n + 1;
+
+    // Fisher-Yates over the groups.  part uses the stream backwards, so
+    // step j uses draw numGroups-j-1.
+    for (i=0;i<numGroups;i++)
+	shuffle[i] = i;
+    {
+	uint64_t *draws = malloc(numGroups * sizeof(uint64_t));
+	for (i=0;i<numGroups;i++) {
+	    if (useCtr)
+		draws[i] = ctrDraw(keyShuf, i);
+	    else
+		draws[i] = mwc(&shufW, &shufZ);
+	}
+	for (i=0;i<numGroups;i++) {
+	    uint64_t k   = numGroups - i - 1;
+	    uint64_t r;
+	    uint64_t tmp;
+
+	    if (useCtr)
+		r = i + ctrBounded(keyShuf, k, numGroups - i);
+	    else
+		r = i + (uint32_t) draws[k] % (numGroups - i);
+	    tmp = shuffle[i];
+	    shuffle[i] = shuffle[r];
+	    shuffle[r] = tmp;
+	}
+	free(draws);
+    }
+
+    snprintf(cmd, sizeof(cmd), "%s -s %llu -r %s -f u64 %llu %llu", part,
+	    (unsigned long long) seed, useCtr ? "ctr" : "mwc",
+	    (unsigned long long) n, (unsigned long long) m);
+    fflush(stdout);
+    if ((fp = popen(cmd, "r")) == NULL) {
+	perror(cmd);
+	return 1;
+    }
+    for (i=0;fread(pair, sizeof(uint64_t), 2, fp) == 2;i++) {
+	uint64_t g = (i < numGroups) ? shuffle[i] : 0;
+
+	if (i >= numGroups || pair[0] != starts[g] ||
+		pair[1] != starts[g + 1] - 1) {
+	    if (!bad) {
+		printf("  %s: group %llu is %llu..%llu\n", cmd,
+			(unsigned long long) i, (unsigned long long) pair[0],
+			(unsigned long long) pair[1]);
+	    }
+	    bad = 1;
+	} else if (pair[1] - pair[0] + 1 > m) {
+	    printf("  %s: group %llu is bigger than M\n", cmd,
+		    (unsigned long long) i);
+	    bad = 1;
+	}
+    }
+    if (pclose(fp) != 0 || i != numGroups) {
+	printf("  %s: got %llu groups, expected %llu\n", cmd,
+		(unsigned long long) i, (unsigned long long) numGroups);
+	bad = 1;
+    }
+
+    free(starts);
+    free(shuffle);
+    return bad;
+}
+
+/**
+ * The same MWC generator as rng() in part.c.
+ */
+static uint32_t mwc(uint32_t *w, uint32_t *z)
+{
+    *w = 18000*(*w & 65535) + (*w >> 16);
+    *z = 36969*(*z & 65535) + (*z >> 16);
+    return (*z << 16) + *w;
+}
+
+/**
+ * Times generating the whole shuffle of 0..n-1, giving up after budget
+ * seconds.  The time is only checked every so often so that checking it
+ * doesn't dominate the fast mode.
+ */
+static void timeVShuffle(int mode, uint64_t n, double budget)
+{
+    VShuffle vs;
+    uint64_t i     = 0;
+    uint64_t sum   = 0;
+    double   start = now();
+    double   spent = 0;
+    double   total = 0;
+
+    vshuffleInit(&vs, n, 1, mode);
+    for (i=0;i<n;i++) {
+	sum += vshuffleAt(&vs, i);
+	if ((i & 255) == 0 && now() - start > budget) {
+	    i++;
+	    break;
+	}
+    }
+    spent = now() - start;
+
+    // Element i of the replayed shuffle costs O(i), so the first i
+    // elements cost O(i^2).
+    if (mode == VSHUFFLE_FEISTEL)
+	total = spent * ((double) n / i);
+    else
+	total = spent * ((double) n / i) * ((double) n / i);
+
+    sink += sum;
+    printf("%-8s %12llu %9.1f%% %14.1f %14.3g\n", modeNames[mode],
+	    (unsigned long long) n, 100.0 * i / n, 1e9 * spent / i, total);
+}
+
+/**
+ * Times the part program with groups of up to 10 elements, killing it
+ * after budget seconds.
+ */
+static void timePart(const char *part, uint64_t n, double budget)
+{
+    char     nArg[32];
+    pid_t    pid   = 0;
+    double   start = now();
+    double   spent = 0;
+    int      done  = 0;
+    int      status;
+
+    snprintf(nArg, sizeof(nArg), "%llu", (unsigned long long) n - 1);
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+	if (freopen("/dev/null", "w", stdout) == NULL)
+	    _exit(127);
+	execl(part, part, "-r", "ctr", "-s", "1", nArg, "10", (char *) NULL);
+	_exit(127);
+    }
+
+    while (!done) {
+	usleep(1000);
+	done = waitpid(pid, &status, WNOHANG) == pid;
+	if (!done && now() - start > budget) {
+	    kill(pid, SIGKILL);
+	    waitpid(pid, &status, 0);
+	    break;
+	}
+    }
+    spent = now() - start;
+
+    if (done && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+	printf("%-8s %12llu %10s %14s %14s\n", "part",
+		(unsigned long long) n, "failed", "-", "-");
+    } else if (done) {
+	printf("%-8s %12llu %9.1f%% %14.1f %14.3g\n", "part",
+		(unsigned long long) n, 100.0, 1e9 * spent / n, spent);
+    } else {
+	printf("%-8s %12llu %10s %14s %14s\n", "part",
+		(unsigned long long) n, "timeout", "-", "-");
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -1,55 +1,117 @@
 /* Given a number N, shuffle the elements from 0..N-1 and print them. */
 /* This algorithm uses O(1) space. */
+/*
+ * There are two modes:
+ *
+ *   ref     - Replays the Fisher-Yates shuffle backwards for every element.
+ *             O(1) space but O(n^2) time.  This is the default.  The random
+ *             numbers come from the counter based rng in ctrrng.h, which
+ *             handles N up to 2^64-1 and picks each slot without bias.
+ *   feistel - Encrypts each index with a keyed Feistel network.  O(1) space
+ *             and O(1) expected time per element.
+ *
+ * Usage: shuffle [-f FORMAT] [-s SEED] [-a POS | -p ELEM] N [ref|feistel]
+ *
+ *   -f  Output format: text (the default), u32, u64 or varint.  See
+ *       fastout.h.
+ *   -s  Seed.  The same seed always gives the same shuffle.  The default is
+ *       the current time.
+ *   -a  Only print the element at output position POS.
+ *   -p  Only print the output position of element ELEM.
+ *
+ * The permutation itself lives in vshuffle.c, so build with:
+ *
+ * cc -O2 shuffle.c vshuffle.c -o shuffle
+ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include "fastout.h"
+#include "vshuffle.h"
 
-static void shuffle(int n);
+static void shuffle(const VShuffle *vs, FastOut *out);
 
 int main(int argc, char *argv[])
 {
-    if (argc < 2) {
-	printf("Usage: shuffle N\n");
-	exit(0);
+    const char *mode   = "ref";
+    int         format = OUT_TEXT;
+    int         opt    = 0;
+    int         query  = 0;
+    uint64_t    arg    = 0;
+    uint64_t    n      = 0;
+    uint64_t    seed   = time(NULL);
+    VShuffle    vs;
+    FastOut     out;
+
+    while ((opt = getopt(argc, argv, "f:s:a:p:")) != -1) {
+	switch (opt) {
+	    case 'f':
+		if ((format = fastOutFormat(optarg)) < 0)
+		    goto usage;
+		break;
+	    case 's':
+		seed = strtoull(optarg, NULL, 0);
+		break;
+	    case 'a':
+	    case 'p':
+		query = opt;
+		arg   = strtoull(optarg, NULL, 0);
+		break;
+	    default:
+		goto usage;
+	}
+    }
+    if (optind >= argc)
+	goto usage;
+    n = strtoull(argv[optind], NULL, 0);
+    if (optind + 1 < argc)
+	mode = argv[optind + 1];
+    if (n > 0 && !fastOutFits(format, n - 1)) {
+	printf("N must be at most 2^32 for -f u32\n");
+	exit(1);
+    }
+
+    if (strcmp(mode, "ref") == 0) {
+	vshuffleInit(&vs, n, seed, VSHUFFLE_REF);
+    } else if (strcmp(mode, "feistel") == 0) {
+	vshuffleInit(&vs, n, seed, VSHUFFLE_FEISTEL);
+    } else {
+	printf("Unknown mode: %s\n", mode);
+	exit(1);
     }
 
-    shuffle(atoi(argv[1]));
+    if (query != 0 && arg >= n) {
+	printf("%llu is not less than N\n", (unsigned long long) arg);
+	exit(1);
+    }
+
+    fastOutInit(&out, STDOUT_FILENO, format);
+    if (query == 'a')
+	fastOutNum(&out, vshuffleAt(&vs, arg));
+    else if (query == 'p')
+	fastOutNum(&out, vshufflePosition(&vs, arg));
+    else
+	shuffle(&vs, &out);
+    fastOutFree(&out);
     return 0;
+
+usage:
+    printf("Usage: shuffle [-f text|u32|u64|varint] [-s SEED] "
+	    "[-a POS | -p ELEM] N [ref|feistel]\n");
+    exit(0);
 }
 
-static void shuffle(int n)
+/**
+ * Prints the element at every output position in order.  Each one is
+ * computed on its own, so nothing needs to be stored.
+ */
+static void shuffle(const VShuffle *vs, FastOut *out)
 {
-    uint32_t seedOriginal = time(NULL);
-    uint32_t seed         = 0;
-    int      i            = 0;
-    int      j            = 0;
-    int      slot         = 0;
-
-    for (i=0;i<n;i++) {
-	seed = seedOriginal;
-	srand(seed);
-
-	// Skip n-i-1 random numbers.
-	for (j=n-i-1;j>0;j--)
-	    rand();
-
-	// Select an array slot from [i..n-1].
-	slot = i + (rand() % (n - i));
-
-	// Find out what that slot corresponds to in the original order.
-	// We do this by backtracking through all the previous steps.
-	for (j=i-1;j>=0;j--) {
-	    int r = j + (rand() % (n - j));
-
-	    // Every time we see the slot we are looking for, we switch
-	    // to looking for slot j instead, because at this previous step
-	    // we swapped array[j] with array[slot].
-	    if (r == slot)
-		slot = j;
-	}
+    uint64_t i = 0;
 
-	// Slot is now the correct element we are looking for.
-	printf("%d\n", slot);
-    }
+    for (i=0;i<vs->n;i++)
+	fastOutNum(out, vshuffleAt(vs, i));
 }
@@ -0,0 +1,171 @@
+/* Random access into a virtual shuffle.  See vshuffle.h. */
+#include <stdint.h>
+#include "vshuffle.h"
+#include "ctrrng.h"
+
+#define FEISTEL_ROUNDS	6
+
+static uint64_t refSlot(const VShuffle *vs, uint64_t step);
+static uint64_t feistelEncrypt(const VShuffle *vs, uint64_t x);
+static uint64_t feistelDecrypt(const VShuffle *vs, uint64_t x);
+static uint64_t feistelRound(uint64_t key, int round, uint64_t value);
+
+/**
+ * Sets up a shuffle of 0..n-1.  For the Feistel mode, the network covers
+ * the smallest power of two that is >= n, and the bits are split into two
+ * halves that differ by at most one bit.
+ */
+void vshuffleInit(VShuffle *vs, uint64_t n, uint64_t seed, int mode)
+{
+    int bits = 2;
+
+    while (bits < 64 && (UINT64_C(1) << bits) < n)
+	bits++;
+
+    vs->n         = n;
+    vs->key       = ctrMix(seed);
+    vs->mode      = mode;
+    vs->leftBits  = bits / 2;
+    vs->rightBits = bits - vs->leftBits;
+}
+
+/**
+ * In the reference mode, step j of the Fisher-Yates shuffle swaps array[j]
+ * with array[r], where r is the j-th number of the counter based rng,
+ * reduced to [j..n-1].
+ *
+ * To find the element at position pos, we take the slot that step pos
+ * picked and work backwards.  Every time an earlier step j picked the slot
+ * we are looking for, the element there came from slot j, so we switch to
+ * looking for slot j.  See shuffleGroups() in part.c for a worked example.
+ *
+ * In the Feistel mode, the element at pos is just the encryption of pos.
+ * The Feistel network permutes 0..2^bits-1, which can be up to twice as
+ * big as n.  If the result lands outside of 0..n-1, we just encrypt it
+ * again ("cycle walking").  Because the network is a permutation,
+ * following the cycle from pos must come back into 0..n-1, and since at
+ * least half of the domain is in range, this takes fewer than 2 tries on
+ * average.
+ */
+uint64_t vshuffleAt(const VShuffle *vs, uint64_t pos)
+{
+    uint64_t slot = 0;
+    uint64_t j    = 0;
+
+    if (vs->mode == VSHUFFLE_FEISTEL) {
+	do {
+	    pos = feistelEncrypt(vs, pos);
+	} while (pos >= vs->n);
+	return pos;
+    }
+
+    slot = refSlot(vs, pos);
+    for (j=pos;j-->0;) {
+	if (refSlot(vs, j) == slot)
+	    slot = j;
+    }
+    return slot;
+}
+
+/**
+ * The inverse goes forwards instead.  Element elem starts in slot elem.
+ * At step j, if it is in slot j it moves to the slot that step j picked,
+ * and if it is in the picked slot it moves to slot j.  Once step j is done
+ * nothing touches slot j again, so as soon as the element is in slot j
+ * after step j, j is its final position.  It can never be in a slot
+ * below j, so this ends after at most n steps.
+ *
+ * In the Feistel mode, we decrypt instead of encrypt, walking the cycle
+ * the other way.
+ */
+uint64_t vshufflePosition(const VShuffle *vs, uint64_t elem)
+{
+    uint64_t j = 0;
+
+    if (vs->mode == VSHUFFLE_FEISTEL) {
+	do {
+	    elem = feistelDecrypt(vs, elem);
+	} while (elem >= vs->n);
+	return elem;
+    }
+
+    for (j=0;;j++) {
+	uint64_t r = refSlot(vs, j);
+
+	if (elem == j)
+	    elem = r;
+	else if (elem == r)
+	    elem = j;
+	if (elem == j)
+	    return j;
+    }
+}
+
+/**
+ * Returns the slot picked by step step of the reference shuffle.
+ */
+static uint64_t refSlot(const VShuffle *vs, uint64_t step)
+{
+    return step + ctrBounded(vs->key, step, vs->n - step);
+}
+
+/**
+ * Encrypts x, which is split into a left half of leftBits bits and a right
+ * half of rightBits bits.  Each round maps (L, R) to (R, L ^ F(R)), which
+ * swaps the widths of the two halves.  The round function is truncated to
+ * the width of L, so each round is a permutation no matter what F is.
+ * With an even number of rounds the halves end up at their original
+ * widths.
+ */
+static uint64_t feistelEncrypt(const VShuffle *vs, uint64_t x)
+{
+    int      lBits = vs->leftBits;
+    int      rBits = vs->rightBits;
+    uint64_t left  = x >> rBits;
+    uint64_t right = x & ((UINT64_C(1) << rBits) - 1);
+    int      round = 0;
+
+    for (round=0;round<FEISTEL_ROUNDS;round++) {
+	uint64_t mask     = (UINT64_C(1) << lBits) - 1;
+	uint64_t newRight = (left ^ feistelRound(vs->key, round, right)) & mask;
+	int      tmp      = lBits;
+
+	left  = right;
+	right = newRight;
+	lBits = rBits;
+	rBits = tmp;
+    }
+    return (left << rBits) | right;
+}
+
+/**
+ * Undoes feistelEncrypt() by running the rounds backwards.  Each round
+ * maps (L', R') back to (R' ^ F(L'), L').
+ */
+static uint64_t feistelDecrypt(const VShuffle *vs, uint64_t x)
+{
+    uint64_t left  = x >> vs->rightBits;
+    uint64_t right = x & ((UINT64_C(1) << vs->rightBits) - 1);
+    int      round = 0;
+
+    for (round=FEISTEL_ROUNDS-1;round>=0;round--) {
+	// The width that L had going into this round.
+	int      lBits   = (round & 1) ? vs->rightBits : vs->leftBits;
+	uint64_t mask    = (UINT64_C(1) << lBits) - 1;
+	uint64_t newLeft = (right ^ feistelRound(vs->key, round, left)) & mask;
+
+	right = left;
+	left  = newLeft;
+    }
+    return (left << vs->rightBits) | right;
+}
+
+/**
+ * The round function.  This is the SplitMix64 finalizer applied to the
+ * value mixed with the key and round number.  It doesn't need to be
+ * invertible.
+ */
+static uint64_t feistelRound(uint64_t key, int round, uint64_t value)
+{
+    return ctrMix(value + key + (round + 1) * CTR_GAMMA);
+}
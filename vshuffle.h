@@ -0,0 +1,50 @@
+/* Random access into a virtual shuffle of 0..N-1.
+ *
+ * This is the permutation behind shuffle.c as a library.  Nothing is ever
+ * stored except a key, so N can be anything up to 2^64-1, and you can ask
+ * what element is at output position i, or at what position element x
+ * lands, without generating the rest of the sequence.
+ *
+ * There are two modes, which give different permutations for the same
+ * seed:
+ *
+ *   VSHUFFLE_REF     - The Fisher-Yates shuffle replayed backwards, as in
+ *                      part.c.  Both lookups take O(i) time.
+ *   VSHUFFLE_FEISTEL - A keyed Feistel network with cycle walking.  Both
+ *                      lookups take O(1) expected time.
+ *
+ * The same seed always gives the same permutation.
+ */
+#ifndef VSHUFFLE_H
+#define VSHUFFLE_H
+
+#include <stdint.h>
+
+enum {
+    VSHUFFLE_REF,
+    VSHUFFLE_FEISTEL
+};
+
+typedef struct VShuffle {
+    uint64_t n;
+    uint64_t key;
+    int      mode;
+    int      leftBits;     // Feistel: width of the left half into round 0
+    int      rightBits;    // Feistel: width of the right half into round 0
+} VShuffle;
+
+void     vshuffleInit(VShuffle *vs, uint64_t n, uint64_t seed, int mode);
+
+/**
+ * Returns the element at output position pos.  pos must be less than n.
+ */
+uint64_t vshuffleAt(const VShuffle *vs, uint64_t pos);
+
+/**
+ * Returns the output position of element elem.  This is the inverse of
+ * vshuffleAt(), so vshuffleAt(vs, vshufflePosition(vs, x)) == x.  elem
+ * must be less than n.
+ */
+uint64_t vshufflePosition(const VShuffle *vs, uint64_t elem);
+
+#endif